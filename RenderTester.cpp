@@ -0,0 +1,77 @@
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <iostream>
+
+#include "raymarch/raymarch.hpp"
+
+// Headless check of the two render paths: the raster and the ray marched
+// frames of small scenes have to cover the same pixels. Draws into an
+// offscreen framebuffer of a surfaceless EGL context, so no window or display
+// is needed. Run from build/ for the shaders, exits with 77 (skipped) when
+// no EGL device is available.
+
+#define RENDER_TEST_RADIUS 24
+#define RENDER_TEST_BLOCK 32
+#define RENDER_TEST_SKIPPED 77
+
+int failedChecks = 0;
+
+void check(bool passed, const char *name)
+{
+  std::cout << (passed ? "TEST::PASS " : "TEST::FAIL ") << name << std::endl;
+  if (!passed)
+    failedChecks++;
+}
+
+// a core 3.3 context without a surface, false when the driver has none
+bool createContext()
+{
+  PFNEGLGETPLATFORMDISPLAYEXTPROC t_getPlatformDisplay =
+      (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+  EGLDisplay t_display = t_getPlatformDisplay ? t_getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr)
+                                              : eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  EGLint t_major, t_minor;
+  if (t_display == EGL_NO_DISPLAY || !eglInitialize(t_display, &t_major, &t_minor))
+    return false;
+  EGLint t_configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig t_config;
+  EGLint t_configCount = 0;
+  eglChooseConfig(t_display, t_configAttributes, &t_config, 1, &t_configCount);
+  if (!eglBindAPI(EGL_OPENGL_API))
+    return false;
+  EGLint t_contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                  EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+  EGLContext t_context = eglCreateContext(t_display, t_configCount ? t_config : nullptr, EGL_NO_CONTEXT, t_contextAttributes);
+  if (t_context == EGL_NO_CONTEXT || !eglMakeCurrent(t_display, EGL_NO_SURFACE, EGL_NO_SURFACE, t_context))
+    return false;
+  return gladLoadGLLoader((GLADloadproc)eglGetProcAddress) != 0;
+}
+
+// pixels only one path drew are allowed along silhouettes, where triangle
+// edges and marched rays may round a pixel either way, but nowhere else
+void checkScene(const char *name, const RayMarchScene &scene)
+{
+  std::cout << name << " " << scene.voxelCount << " voxels, " << scene.coveredPixels << " pixels, "
+            << scene.coverageMismatches << " differ in coverage, " << scene.interiorMismatches
+            << " off the silhouettes, " << scene.colorMismatches << " in colour" << std::endl;
+  std::string t_name = std::string("RAYMARCH::") + name;
+  check(scene.coveredPixels > 0 && scene.interiorMismatches == 0, (t_name + "::COVERAGE").c_str());
+  check(scene.coverageMismatches * 100 <= scene.coveredPixels, (t_name + "::SILHOUETTE").c_str());
+}
+
+int main()
+{
+  if (!createContext())
+  {
+    std::cout << "TEST::SKIPPED no EGL context" << std::endl;
+    return RENDER_TEST_SKIPPED;
+  }
+  RayMarchBenchmark t_result = benchmarkRayMarching(RENDER_TEST_RADIUS, RENDER_TEST_BLOCK, 1);
+  checkScene("BALL", t_result.ball);
+  checkScene("NOISE", t_result.noise);
+  check(glGetError() == GL_NO_ERROR, "RAYMARCH::GL_ERRORS");
+  if (failedChecks)
+    std::cout << "TEST::FAILED " << failedChecks << " checks" << std::endl;
+  return failedChecks ? 1 : 0;
+}
@@ -17,9 +17,13 @@
 #include "material/material.hpp"
 #include "camera/camera.hpp"
 #include "file_handler/file_handler.hpp"
+#include "job_system/job_system.hpp"
 #include "material/material.hpp"
 #include "object/object.hpp"
+#include "raycast/ray_box.hpp"
 #include "shader/shader.hpp"
+#include "svo/dag.hpp"
+#include "svo/svo.hpp"
 
 // Timings
 float currentFrame = 0;
@@ -29,6 +33,24 @@ float frameTime[FRAME_TIME_SIZE];
 bool wireVisible = false;
 bool colorMode = true;
 bool optimizedMode = true;
+bool greedyMode = false;
+bool binaryMesher = false;
+bool instancedMode = false;
+bool rayMarchMode = false;
+bool occlusionCulling = false;
+bool lodMode = false;
+bool ambientOcclusion = false;
+MesherBenchmark mesherBenchmark = {0, 0, 0, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+std::vector<float> meshingBenchmark;
+RaycastBenchmark raycastBenchmark = {0, 0, 0, 0.f, 0.f};
+BrickMapBenchmark brickMapBenchmark = {};
+RayBoxBenchmark rayBoxBenchmark = {};
+VoxelFileBenchmark voxelFileBenchmark = {0, 0, 0, 0.f, 0.f, 0.f};
+SvoBenchmark svoBenchmark = {};
+SparseVoxelOctree octree;
+float octreeBuildTime = 0.f;
+DagBenchmark dagBenchmark = {};
+RayMarchBenchmark rayMarchBenchmark = {};
 
 Light light = {{0.f, 0.f, -1.f},
                {0.2f, 0.2f, 0.2f},
@@ -113,6 +135,7 @@ public:
 private:
   GLFWwindow *window;
   Camera *camera;
+  JobSystem *jobSystem;
   Object *object;
   MVP mvp;
   StateHandler *stateHandler;
@@ -159,7 +182,8 @@ private:
 
   void initEngine()
   {
-    object = new Object();
+    jobSystem = new JobSystem();
+    object = new Object(jobSystem);
     camera = new Camera();
     stateHandler = new StateHandler();
     materials = loadMaterialNames();
@@ -174,6 +198,9 @@ private:
     while (!glfwWindowShouldClose(window))
     {
       glfwPollEvents();
+      object->UpdateResidency(camera->Position);
+      object->UpdateLods(camera->Position, lodMode);
+      object->UpdateMeshes(getMeshMode(), ambientOcclusion);
       drawFrame();
       drawGUI();
       glfwSwapBuffers(window);
@@ -207,7 +234,27 @@ private:
 
     processInput();
 
-    object->Draw(mvp, camera->Position, light, optimizedMode);
+    object->Draw(mvp, camera->Position, light, getRenderMode());
+  }
+
+  RenderMode getRenderMode()
+  {
+    if (rayMarchMode)
+      return RenderMode::RayMarch;
+    if (instancedMode)
+      return RenderMode::Instanced;
+    return RenderMode::Chunks;
+  }
+
+  MeshMode getMeshMode()
+  {
+    if (greedyMode && binaryMesher)
+      return MeshMode::Binary;
+    if (greedyMode)
+      return MeshMode::Greedy;
+    if (optimizedMode)
+      return MeshMode::Culled;
+    return MeshMode::Naive;
   }
 
   void drawGUI()
@@ -237,10 +284,37 @@ private:
 
   void cleanup()
   {
+    delete jobSystem;
     glfwDestroyWindow(window);
     glfwTerminate();
   }
 
+  void svoSceneGUI(const char *name, const SvoBenchmarkScene &scene)
+  {
+    ImGui::Text("%s: %u voxels, octree %zu KB, dense %zu KB, built in %.2f ms", name, scene.voxelCount,
+                scene.svoBytes / 1024, scene.denseBytes / 1024, scene.buildTime);
+    ImGui::Text("Points: octree %.1f ns, dense %.1f ns", scene.svoPointTime, scene.densePointTime);
+    ImGui::Text("Rays: octree %.2f us, DDA %.2f us, %u mismatches", scene.svoRayTime, scene.ddaRayTime, scene.mismatches);
+  }
+
+  void dagModelGUI(const char *name, const DagBenchmarkModel &model)
+  {
+    ImGui::Text("%s: %u voxels, %zu -> %zu nodes, %zu -> %zu KB (%.1fx)", name, model.voxelCount, model.svoNodes,
+                model.dagNodes, model.svoBytes / 1024, model.dagBytes / 1024,
+                model.dagBytes ? (float)model.svoBytes / model.dagBytes : 0.f);
+    ImGui::Text("Built in %.2f ms, %.2f ms parallel, %u mismatches", model.serialBuildTime, model.parallelBuildTime,
+                model.mismatches);
+  }
+
+  void rayMarchSceneGUI(const char *name, const RayMarchScene &scene)
+  {
+    ImGui::Text("%s: %u voxels, %u triangles (%zu KB), volume %zu KB", name, scene.voxelCount, scene.triangles,
+                scene.meshBytes / 1024, scene.volumeBytes / 1024);
+    ImGui::Text("Raster %.2f ms, ray marched %.2f ms per frame", scene.rasterTime, scene.rayMarchTime);
+    ImGui::Text("%u pixels, %u differ in coverage (%u off the silhouettes), %u in colour", scene.coveredPixels,
+                scene.coverageMismatches, scene.interiorMismatches, scene.colorMismatches);
+  }
+
   void debugGUI()
   {
     ImGui::Begin("Debug", &stateHandler->debugWindow);
@@ -248,6 +322,153 @@ private:
       wireVisible ^= true;
     if (ImGui::Button("Optimized mode"))
       optimizedMode ^= true;
+    ImGui::SameLine();
+    if (ImGui::Button("Greedy mode"))
+      greedyMode ^= true;
+    ImGui::SameLine();
+    if (ImGui::Button("Binary mesher"))
+      binaryMesher ^= true;
+    if (ImGui::Button("Ambient occlusion"))
+      ambientOcclusion ^= true;
+    ImGui::SameLine();
+    ImGui::Text(ambientOcclusion ? "On" : "Off");
+    if (ImGui::Button("Instanced mode"))
+      instancedMode ^= true;
+    ImGui::SameLine();
+    if (ImGui::Button("Ray march mode"))
+      rayMarchMode ^= true;
+    ImGui::SameLine();
+    if (rayMarchMode)
+      ImGui::Text("Rendering: ray marched");
+    else
+      ImGui::Text(instancedMode ? "Rendering: instanced" : "Rendering: chunk meshes");
+    VolumeStats volumeStats = object->GetVolumeStats();
+    if (rayMarchMode && volumeStats.size.x)
+      ImGui::Text("Volume %dx%dx%d, %zu KB, uploaded in %.2f ms", volumeStats.size.x, volumeStats.size.y,
+                  volumeStats.size.z, volumeStats.bytes / 1024, volumeStats.uploadTime);
+    if (rayMarchMode && volumeStats.tooLarge)
+      ImGui::TextColored(ImVec4(1.f, 0.5f, 0.f, 1.f), "Too large to ray march, drawing chunk meshes instead");
+    if (ImGui::Button("Benchmark ray marching"))
+      rayMarchBenchmark = benchmarkRayMarching(RAYMARCH_BENCHMARK_RADIUS, RAYMARCH_BENCHMARK_BLOCK, RAYMARCH_BENCHMARK_FRAMES);
+    if (rayMarchBenchmark.ball.voxelCount)
+    {
+      rayMarchSceneGUI("Ball", rayMarchBenchmark.ball);
+      rayMarchSceneGUI("Noise", rayMarchBenchmark.noise);
+    }
+    MeshStats meshStats = object->GetMeshStats();
+    ImGui::Text("Triangles before merging: %u", meshStats.visibleFaces * 2);
+    ImGui::Text("Triangles drawn: %u", meshStats.quads * 2);
+    ImGui::Text("Mesh build time: %.3f ms", meshStats.buildTime);
+    ImGui::Text("Vertex buffers: %zu KB", (size_t)meshStats.quads * 4 * sizeof(MeshVertex) / 1024);
+    if (ImGui::Button("Occlusion culling"))
+    {
+      occlusionCulling ^= true;
+      object->SetOcclusionCulling(occlusionCulling);
+    }
+    ImGui::SameLine();
+    ImGui::Text(occlusionCulling ? "On" : "Off");
+    CullStats cullStats = object->GetCullStats();
+    ImGui::Text("Chunks drawn: %u, frustum culled: %u", cullStats.drawnChunks, cullStats.culledChunks);
+    ImGui::Text("Chunks occluded: %u by %u occluders", cullStats.occludedChunks, cullStats.occluders);
+    if (ImGui::Button("LOD"))
+      lodMode ^= true;
+    ImGui::SameLine();
+    ImGui::Text(lodMode ? "On" : "Off");
+    LodStats lodStats = object->GetLodStats();
+    for (int i = 0; i < LOD_LEVELS; i++)
+      ImGui::Text("LOD %d (1/%d): %u chunks, %u triangles", i, 1 << i, lodStats.chunks[i], lodStats.triangles[i]);
+    RemeshStats remeshStats = object->GetRemeshStats();
+    ImGui::Text("Chunks remeshed this frame: %u (%.3f ms)", remeshStats.chunks, remeshStats.time);
+    if (ImGui::Button("Benchmark threaded meshing"))
+      meshingBenchmark = benchmarkChunkMeshing(jobSystem->GetThreadCount());
+    for (size_t i = 0; i < meshingBenchmark.size(); i++)
+      ImGui::Text("%zu threads: %.0f chunks/s", i + 1, meshingBenchmark[i]);
+    ImGui::Text("Voxels: %zu (%zu bytes each)", object->GetVoxelCount(), sizeof(Voxel));
+    ImGui::Text("Chunks: %zu (%zu KB)", object->GetChunkMap().GetChunkCount(),
+                object->GetChunkMap().GetMemoryUsage() / 1024);
+    const BrickMap &brickMap = object->GetBrickMap();
+    ImGui::Text("Brick map: %zu bricks, %zu solid (%zu KB)", brickMap.GetPoolBrickCount(),
+                brickMap.GetSolidBrickCount(), brickMap.GetMemoryUsage() / 1024);
+    PagingStats pagingStats = object->GetPagingStats();
+    ImGui::Text("Resident chunks: %u (%zu KB), paged out: %u", pagingStats.residentChunks,
+                pagingStats.residentBytes / 1024, pagingStats.evictedChunks);
+    ImGui::Text("Page ins: %u, last %.3f ms, average %.3f ms", pagingStats.pageIns, pagingStats.lastPageInTime,
+                pagingStats.pageIns ? pagingStats.totalPageInTime / pagingStats.pageIns : 0.f);
+    ImGui::Text("Region file: %zu KB", pagingStats.regionBytes / 1024);
+    if (ImGui::Button("Benchmark meshers"))
+      mesherBenchmark = benchmarkMeshers();
+    if (mesherBenchmark.voxelCount)
+    {
+      ImGui::Text("%u voxels", mesherBenchmark.voxelCount);
+      ImGui::Text("Scalar: %u faces in %.2f ms", mesherBenchmark.scalarFaces, mesherBenchmark.scalarTime);
+      ImGui::Text("Binary: %u faces in %.2f ms", mesherBenchmark.binaryFaces, mesherBenchmark.binaryTime);
+      ImGui::Text("Greedy meshing: %.2f ms, with AO %.2f ms", mesherBenchmark.meshTime, mesherBenchmark.aoMeshTime);
+      ImGui::Text("Binary meshing: %.2f ms, with AO %.2f ms", mesherBenchmark.binaryMeshTime,
+                  mesherBenchmark.binaryAoMeshTime);
+    }
+    if (ImGui::Button("Benchmark picking"))
+      raycastBenchmark = benchmarkRaycast();
+    if (raycastBenchmark.voxelCount)
+    {
+      ImGui::Text("%u voxels, %u mismatches in %u rays", raycastBenchmark.voxelCount,
+                  raycastBenchmark.mismatches, raycastBenchmark.rays);
+      ImGui::Text("DDA: %.4f ms per ray", raycastBenchmark.ddaTime);
+      ImGui::Text("Brute force: %.4f ms per ray", raycastBenchmark.bruteForceTime);
+    }
+    if (ImGui::Button("Benchmark ray-box kernel"))
+      rayBoxBenchmark = benchmarkRayBoxes();
+    if (rayBoxBenchmark.boxes)
+    {
+      ImGui::Text("%u rays against %u boxes, %s kernel", rayBoxBenchmark.rays, rayBoxBenchmark.boxes, rayBoxBenchmark.path);
+      ImGui::Text("Scalar: %.1f M tests/s, kernel: %.1f M tests/s", rayBoxBenchmark.scalarRate, rayBoxBenchmark.simdRate);
+      ImGui::Text("%u distance errors, %u hit errors", rayBoxBenchmark.distanceErrors, rayBoxBenchmark.hitErrors);
+    }
+    if (ImGui::Button("Benchmark brick map"))
+      brickMapBenchmark = benchmarkBrickMap();
+    if (brickMapBenchmark.voxelCount)
+    {
+      ImGui::Text("%u voxels, %zu bricks, %zu solid (%zu KB) built in %.2f ms", brickMapBenchmark.voxelCount,
+                  brickMapBenchmark.poolBricks, brickMapBenchmark.solidBricks, brickMapBenchmark.bytes / 1024,
+                  brickMapBenchmark.buildTime);
+      ImGui::Text("Brick map: %.3f us per ray, %u hits in %u rays", brickMapBenchmark.brickMapTime,
+                  brickMapBenchmark.hits, brickMapBenchmark.rays);
+      ImGui::Text("DDA: %.3f us per ray, %u of %u rays differ, %u wrong", brickMapBenchmark.ddaTime,
+                  brickMapBenchmark.ddaDiffs, brickMapBenchmark.ddaRays, brickMapBenchmark.mismatches);
+    }
+    if (ImGui::Button("Benchmark model loading"))
+      voxelFileBenchmark = benchmarkVoxelFile();
+    if (voxelFileBenchmark.voxelCount)
+    {
+      ImGui::Text("%u voxels", voxelFileBenchmark.voxelCount);
+      ImGui::Text("Text: %zu KB in %.2f ms", voxelFileBenchmark.textBytes / 1024, voxelFileBenchmark.textLoadTime);
+      ImGui::Text("Binary: %zu KB in %.2f ms", voxelFileBenchmark.binaryBytes / 1024, voxelFileBenchmark.binaryLoadTime);
+      ImGui::Text("Mapped: %.3f ms", voxelFileBenchmark.mappedLoadTime);
+    }
+    if (ImGui::Button("Build octree"))
+    {
+      float t_start = (float)glfwGetTime();
+      octree.Build(object->GetListOfVoxels());
+      octreeBuildTime = ((float)glfwGetTime() - t_start) * 1000.f;
+    }
+    if (octree.GetVoxelCount())
+      ImGui::Text("%zu voxels, %zu nodes, depth %d, %zu KB in %.2f ms", octree.GetVoxelCount(), octree.GetNodeCount(),
+                  octree.GetDepth(), octree.GetMemoryUsage() / 1024, octreeBuildTime);
+    if (ImGui::Button("Benchmark octree"))
+      svoBenchmark = benchmarkSvo();
+    if (svoBenchmark.doggo.voxelCount)
+    {
+      svoSceneGUI("Doggo", svoBenchmark.doggo);
+      svoSceneGUI("Sparse", svoBenchmark.sparse);
+    }
+    if (ImGui::Button("Benchmark DAG"))
+      dagBenchmark = benchmarkDag(jobSystem->GetThreadCount());
+    if (dagBenchmark.threads)
+    {
+      ImGui::Text("%u threads", dagBenchmark.threads);
+      dagModelGUI("Doggo", dagBenchmark.doggo);
+      dagModelGUI("Doggo scaled", dagBenchmark.doggoScaled);
+      dagModelGUI("Test", dagBenchmark.test);
+    }
     ImGui::PlotHistogram("", frameTime, IM_ARRAYSIZE(frameTime), 0, NULL, 0.0f,
                          16.f, ImVec2(200, 80));
     ImGui::End();
@@ -275,7 +496,7 @@ private:
         if (ImGui::MenuItem("New Model"))
         {
           object->Reset();
-          object->AddVoxel(glm::ivec3(0, 0, 0), loadMaterial("ruby"));
+          object->AddVoxel(glm::ivec3(0, 0, 0), registerMaterial(loadMaterial("ruby")));
         }
         ImGui::MenuItem("Open Model", "", &stateHandler->OpenModelWindow);
         ImGui::MenuItem("Save As", "", &stateHandler->saveAsWindow);
@@ -304,6 +525,12 @@ private:
       object->Save();
     }
     ImGui::SameLine();
+    if (ImGui::Button("Export Text"))
+    {
+      stateHandler->saveAsWindow = false;
+      object->Export();
+    }
+    ImGui::SameLine();
     if (ImGui::Button("Cancel"))
     {
       stateHandler->saveAsWindow = false;
@@ -335,7 +562,7 @@ private:
     ImGui::Begin("Voxel Handler", &stateHandler->objectWindow);
     ImGui::InputInt3("Voxel Position", (int *)&pos);
     if (ImGui::Button("Add Voxel"))
-      object->AddVoxel(pos, loadMaterial(activeMaterialName));
+      object->AddVoxel(pos, registerMaterial(loadMaterial(activeMaterialName)));
     ImGui::SameLine();
     if (ImGui::Button("Remove Voxel"))
       object->RemoveVoxel(pos);
@@ -399,6 +626,9 @@ private:
       }
       saveMaterial(newMaterial, newMaterial.name, t_edit);
       materials = loadMaterialNames();
+      // meshes only store material IDs, the palette upload picks this up
+      if (t_edit)
+        registerMaterial(loadMaterial(newMaterial.name));
     }
     ImGui::SameLine();
     if (ImGui::Button("Refresh"))
@@ -483,12 +713,12 @@ private:
       if (t_voxel)
       {
         if (voxelGame->stateHandler->GetColorMode())
-          voxelGame->object->ChangeColor(t_voxel, loadMaterial(voxelGame->activeMaterialName));
+          voxelGame->object->ChangeColor(t_voxel, registerMaterial(loadMaterial(voxelGame->activeMaterialName)));
         if (voxelGame->stateHandler->GetRemoveMode())
           voxelGame->object->RemoveVoxel(t_voxel);
         if (voxelGame->stateHandler->GetAddMode())
         {
-          voxelGame->object->AddVoxel(t_voxel->pos + newBlockLoc, loadMaterial(voxelGame->activeMaterialName));
+          voxelGame->object->AddVoxel(glm::vec3(t_voxel->pos) + newBlockLoc, registerMaterial(loadMaterial(voxelGame->activeMaterialName)));
         }
       }
     }
@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "culling/culling.hpp"
+#include "mesher/mesher.hpp"
+#include "mesher/vertex_layout.hpp"
+#include "raycast/ray_box.hpp"
+#include "raycast/raycast.hpp"
+#include "raycast/ray_benchmark.hpp"
+
+// Headless checks of the CPU side of the engine, no window or GL context is
+// created. Registered with ctest, a failed check makes the run fail.
+
+int failedChecks = 0;
+
+void check(bool passed, const char *name)
+{
+  std::cout << (passed ? "TEST::PASS " : "TEST::FAIL ") << name << std::endl;
+  if (!passed)
+    failedChecks++;
+}
+
+// a wall rasterised into the occlusion buffer, blocks behind it have to be
+// rejected and blocks in front of or beside it kept
+void checkOcclusionCulling()
+{
+  glm::mat4 t_projection = glm::perspective(glm::radians(45.f), (float)OCCLUSION_WIDTH / OCCLUSION_HEIGHT, 0.1f, 500.f);
+  glm::mat4 t_view = glm::lookAt(glm::vec3(0.f, 0.f, 60.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+  OcclusionBuffer t_buffer;
+  t_buffer.Clear(t_projection * t_view);
+  t_buffer.AddOccluder(glm::vec3(-24.f, -24.f, -2.f), glm::vec3(24.f, 24.f, 2.f));
+  t_buffer.BuildPyramid();
+
+  // a 5x5 grid of blocks hidden behind the wall and one in front of it
+  uint32_t t_hiddenBlocks = 0, t_hiddenRejected = 0, t_visibleBlocks = 0, t_visibleKept = 0;
+  for (int x = -2; x <= 2; x++)
+    for (int y = -2; y <= 2; y++)
+    {
+      glm::vec3 t_min = glm::vec3(x * 6.f - 2.f, y * 6.f - 2.f, 0.f);
+      t_hiddenBlocks++;
+      if (!t_buffer.IsVisible(t_min + glm::vec3(0.f, 0.f, -20.f), t_min + glm::vec3(4.f, 4.f, -16.f)))
+        t_hiddenRejected++;
+      t_visibleBlocks++;
+      if (t_buffer.IsVisible(t_min + glm::vec3(0.f, 0.f, 10.f), t_min + glm::vec3(4.f, 4.f, 14.f)))
+        t_visibleKept++;
+    }
+  // partly behind the wall, partly beside it
+  t_visibleBlocks++;
+  if (t_buffer.IsVisible(glm::vec3(20.f, -2.f, -20.f), glm::vec3(32.f, 2.f, -16.f)))
+    t_visibleKept++;
+
+  std::cout << "OCCLUSION " << t_hiddenRejected << "/" << t_hiddenBlocks << " hidden rejected, "
+            << t_visibleKept << "/" << t_visibleBlocks << " visible kept" << std::endl;
+  check(t_hiddenRejected == t_hiddenBlocks, "OCCLUSION::HIDDEN_REJECTED");
+  check(t_visibleKept == t_visibleBlocks, "OCCLUSION::VISIBLE_KEPT");
+}
+
+// every packed vertex has to unpack to what went in, and a one voxel mesh
+// has to decode to the corners the float mesher used to emit
+void checkVertexLayout()
+{
+  uint32_t t_vertices = 0, t_mismatches = 0;
+  const MaterialID t_materials[] = {0, 1, 255, 256, 65535};
+  for (int x = 0; x <= CHUNK_SIZE; x++)
+    for (int y = 0; y <= CHUNK_SIZE; y++)
+      for (int z = 0; z <= CHUNK_SIZE; z++)
+        for (int face = 0; face < 6; face++)
+        {
+          int ao = (x + y + z + face) % (VERTEX_AO_MAX + 1);
+          MaterialID t_mat = t_materials[(x + face) % 5];
+          UnpackedVertex t_vertex = unpackVertex(packVertex(glm::ivec3(x, y, z), face, ao, t_mat));
+          t_vertices++;
+          if (t_vertex.corner != glm::ivec3(x, y, z) || t_vertex.face != face || t_vertex.ao != ao ||
+              t_vertex.material != t_mat)
+            t_mismatches++;
+        }
+
+  // a voxel in a negative chunk, its corners are cell - 0.5 and cell + 0.5
+  // in world space, basic.vert adds the chunk origin and subtracts 0.5
+  glm::ivec3 t_cell = glm::ivec3(-1, 40, -33);
+  ChunkMap t_occupancy;
+  t_occupancy.Set(t_cell, true);
+  std::vector<MeshVertex> t_mesh;
+  std::vector<uint32_t> t_indices;
+  buildMesh({{glm::i16vec3(t_cell), 7}}, t_occupancy, MeshMode::Culled, false, t_mesh, t_indices);
+  glm::ivec3 t_origin = ChunkMap::ChunkCoord(t_cell) * CHUNK_SIZE;
+  for (const MeshVertex &vertex : t_mesh)
+  {
+    UnpackedVertex t_vertex = unpackVertex(vertex);
+    glm::vec3 t_offset = glm::vec3(t_origin + t_vertex.corner) - glm::vec3(0.5f) - glm::vec3(t_cell);
+    t_vertices++;
+    if (glm::abs(t_offset.x) != 0.5f || glm::abs(t_offset.y) != 0.5f || glm::abs(t_offset.z) != 0.5f ||
+        t_vertex.material != 7 || t_offset[t_vertex.face / 2] != (t_vertex.face % 2 == 0 ? 0.5f : -0.5f))
+      t_mismatches++;
+  }
+
+  std::cout << "VERTEX_LAYOUT " << t_mismatches << " mismatches in " << t_vertices << " vertices" << std::endl;
+  check(t_mismatches == 0, "VERTEX_LAYOUT::ROUND_TRIP");
+  check(t_mesh.size() == 24, "VERTEX_LAYOUT::ONE_VOXEL_MESH");
+}
+
+// the compiled box kernel has to match the scalar loop exactly and its
+// nearest hits have to match the slab test against every voxel
+void checkRayBoxes()
+{
+  const int t_size = 64;
+  const int t_voxelCount = 4096;
+  const uint32_t t_rayCount = 2000; // a tenth of the benchmark, enough for an unoptimised build
+
+  // random voxels of the grid, each its own box
+  std::vector<Voxel> t_voxels;
+  AabbList t_boxes;
+  uint32_t t_seed = 2463534242u;
+  for (int i = 0; i < t_voxelCount; i++)
+  {
+    glm::ivec3 t_pos = glm::ivec3(xorshift(t_seed) % t_size, xorshift(t_seed) % t_size, xorshift(t_seed) % t_size);
+    t_voxels.push_back({glm::i16vec3(t_pos), 0});
+    t_boxes.Add(glm::vec3(t_pos) - glm::vec3(0.5f), glm::vec3(t_pos) + glm::vec3(0.5f));
+  }
+  BenchmarkRays t_rays = makeBenchmarkRays(t_seed, t_rayCount, (float)t_size);
+
+  // every distance of each 16th ray, and the nearest hit of every ray
+  float t_range = t_size * 3.f;
+  uint32_t t_distanceErrors = 0, t_hitErrors = 0;
+  std::vector<float> t_scalar(t_boxes.Size()), t_simd(t_boxes.Size());
+  for (uint32_t i = 0; i < t_rayCount; i++)
+  {
+    RaySlab t_ray = makeRaySlab(t_rays.origins[i], t_rays.dirs[i]);
+    if (i % 16 == 0)
+    {
+      intersectBoxesScalar(t_ray, t_boxes, t_range, t_scalar.data());
+      intersectBoxes(t_ray, t_boxes, t_range, t_simd.data());
+      for (size_t k = 0; k < t_scalar.size(); k++)
+        if (t_scalar[k] != t_simd[k])
+          t_distanceErrors++;
+    }
+    float t_distance;
+    glm::ivec3 t_normal;
+    int t_box = nearestBox(t_ray, t_boxes, t_range, t_distance, t_normal);
+    RayHit t_reference = castRayBruteForce(t_voxels, t_rays.origins[i], t_rays.dirs[i], t_range);
+    if (t_reference.hit != (t_box >= 0) ||
+        (t_reference.hit && (t_reference.cell != glm::ivec3(t_voxels[t_box].pos) || t_reference.normal != t_normal)))
+      t_hitErrors++;
+  }
+
+  std::cout << "RAY_BOX " << getRayBoxPath() << " " << t_boxes.Size() << " boxes, " << t_rayCount << " rays, "
+            << t_distanceErrors << " distance errors, " << t_hitErrors << " hit errors" << std::endl;
+  check(t_distanceErrors == 0, "RAY_BOX::KERNEL_MATCHES_SCALAR");
+  check(t_hitErrors == 0, "RAY_BOX::NEAREST_HIT");
+}
+
+// the DDA has to stop in the same voxel, on the same face and at the same
+// distance as the slab test against every voxel, for rays from around and
+// from inside a sparse grid and for rays along the axes
+void checkRaycast()
+{
+  const int t_size = 48;
+  const uint32_t t_outsideRays = 2000;
+  const uint32_t t_insideRays = 500;
+
+  ChunkMap t_occupancy;
+  std::vector<Voxel> t_voxels;
+  uint32_t t_seed = 2463534242u;
+  for (int x = 0; x < t_size; x++)
+    for (int y = 0; y < t_size; y++)
+      for (int z = 0; z < t_size; z++)
+      {
+        if (xorshift(t_seed) & 7)
+          continue;
+        t_voxels.push_back({glm::i16vec3(x, y, z), 0});
+        t_occupancy.Set(glm::ivec3(x, y, z), true);
+      }
+
+  BenchmarkRays t_rays = makeBenchmarkRays(t_seed, t_outsideRays, (float)t_size);
+  for (uint32_t i = 0; i < t_insideRays; i++)
+  {
+    t_rays.origins.push_back(glm::vec3(randomFloat(t_seed), randomFloat(t_seed), randomFloat(t_seed)) * (float)t_size);
+    t_rays.dirs.push_back(glm::vec3(randomFloat(t_seed), randomFloat(t_seed), randomFloat(t_seed)) - glm::vec3(0.5f));
+  }
+  // off the cell boundaries, so no slab is hit edge on
+  for (int y = 0; y < t_size; y += 3)
+    for (int axis = 0; axis < 3; axis++)
+      for (int sign = -1; sign <= 1; sign += 2)
+      {
+        glm::vec3 t_origin = glm::vec3((float)y + 0.25f, (float)(t_size - 1 - y) - 0.25f, (float)y + 0.125f);
+        t_origin[axis] = sign > 0 ? -2.f : (float)t_size + 1.f;
+        glm::vec3 t_dir = glm::vec3(0.f);
+        t_dir[axis] = (float)sign;
+        t_rays.origins.push_back(t_origin);
+        t_rays.dirs.push_back(t_dir);
+      }
+
+  float t_range = t_size * 3.f;
+  uint32_t t_mismatches = 0;
+  for (size_t i = 0; i < t_rays.origins.size(); i++)
+  {
+    RayHit t_hit = castRay(t_occupancy, t_rays.origins[i], t_rays.dirs[i], t_range);
+    RayHit t_reference = castRayBruteForce(t_voxels, t_rays.origins[i], t_rays.dirs[i], t_range);
+    if (t_hit.hit != t_reference.hit ||
+        (t_hit.hit && (t_hit.cell != t_reference.cell || t_hit.normal != t_reference.normal ||
+                       std::abs(t_hit.distance - t_reference.distance) > 1e-4f * std::max(1.f, t_reference.distance))))
+      t_mismatches++;
+  }
+  std::cout << "RAYCAST " << t_voxels.size() << " voxels, " << t_rays.origins.size() << " rays, "
+            << t_mismatches << " mismatches" << std::endl;
+  check(!t_voxels.empty() && t_mismatches == 0, "RAYCAST::DDA_MATCHES_BRUTE_FORCE");
+}
+
+int main()
+{
+  checkOcclusionCulling();
+  checkVertexLayout();
+  checkRayBoxes();
+  checkRaycast();
+  if (failedChecks)
+    std::cout << "TEST::FAILED " << failedChecks << " checks" << std::endl;
+  return failedChecks ? 1 : 0;
+}
@@ -0,0 +1,315 @@
+#include "brickmap.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+static inline glm::ivec3 brickCoord(glm::ivec3 pos)
+{
+    // arithmetic shift, so negative positions round down as well
+    return glm::ivec3(pos.x >> 3, pos.y >> 3, pos.z >> 3);
+}
+
+static inline glm::ivec3 blockCoord(glm::ivec3 brick)
+{
+    return glm::ivec3(brick.x >> 2, brick.y >> 2, brick.z >> 2);
+}
+
+static inline int blockIndex(glm::ivec3 brick)
+{
+    glm::ivec3 t_local = brick & (BRICKMAP_BLOCK_BRICKS - 1);
+    return t_local.x + BRICKMAP_BLOCK_BRICKS * (t_local.y + BRICKMAP_BLOCK_BRICKS * t_local.z);
+}
+
+static inline bool isSolid(const Brick &brick, glm::ivec3 local)
+{
+    return (brick.columns[local.x][local.y] >> local.z) & 1u;
+}
+
+static bool isFilled(const Brick &brick, uint8_t column)
+{
+    for (const auto &row : brick.columns)
+        for (uint8_t value : row)
+            if (value != column)
+                return false;
+    return true;
+}
+
+BrickMap::BrickMap()
+{
+    Clear();
+}
+
+void BrickMap::Clear()
+{
+    m_blocks.clear();
+    m_pool.clear();
+    m_freeBricks.clear();
+    m_min = glm::ivec3(std::numeric_limits<int>::max());
+    m_max = glm::ivec3(std::numeric_limits<int>::min());
+    m_solidBricks = 0;
+}
+
+const uint32_t *BrickMap::coarseCell(glm::ivec3 brick) const
+{
+    auto it = m_blocks.find(blockCoord(brick));
+    if (it == m_blocks.end())
+        return nullptr;
+    return &it->second.cells[blockIndex(brick)];
+}
+
+uint32_t BrickMap::allocateBrick()
+{
+    uint32_t t_index;
+    if (m_freeBricks.empty())
+    {
+        t_index = (uint32_t)m_pool.size();
+        m_pool.emplace_back();
+    }
+    else
+    {
+        t_index = m_freeBricks.back();
+        m_freeBricks.pop_back();
+    }
+    return t_index;
+}
+
+void BrickMap::freeBrick(uint32_t index)
+{
+    m_freeBricks.push_back(index);
+}
+
+Brick BrickMap::loadBrick(glm::ivec3 brick) const
+{
+    Brick t_brick;
+    const uint32_t *cell = coarseCell(brick);
+    if (!cell || *cell == BRICKMAP_EMPTY)
+        std::memset(&t_brick, 0, sizeof(Brick));
+    else if (*cell == BRICKMAP_SOLID)
+        std::memset(&t_brick, 0xff, sizeof(Brick));
+    else
+        t_brick = m_pool[*cell - 1];
+    return t_brick;
+}
+
+// Empty and full bricks need no pool entry; blocks are allocated with their
+// first brick and freed with their last one
+void BrickMap::storeBrick(glm::ivec3 brick, const Brick &bits)
+{
+    bool t_empty = isFilled(bits, 0);
+    bool t_full = !t_empty && isFilled(bits, 0xff);
+    glm::ivec3 t_key = blockCoord(brick);
+    auto it = m_blocks.find(t_key);
+    if (it == m_blocks.end())
+    {
+        if (t_empty)
+            return;
+        it = m_blocks.emplace(t_key, BrickBlock()).first;
+        std::memset(&it->second, 0, sizeof(BrickBlock));
+        m_min = glm::min(m_min, t_key);
+        m_max = glm::max(m_max, t_key);
+    }
+
+    BrickBlock &block = it->second;
+    uint32_t &cell = block.cells[blockIndex(brick)];
+    bool t_used = cell != BRICKMAP_EMPTY;
+    if (cell == BRICKMAP_SOLID)
+        m_solidBricks--;
+    else if (t_used && (t_empty || t_full))
+        freeBrick(cell - 1);
+
+    if (t_empty)
+        cell = BRICKMAP_EMPTY;
+    else if (t_full)
+    {
+        cell = BRICKMAP_SOLID;
+        m_solidBricks++;
+    }
+    else
+    {
+        if (!t_used || cell == BRICKMAP_SOLID)
+            cell = allocateBrick() + 1;
+        m_pool[cell - 1] = bits;
+    }
+
+    block.usedCells = block.usedCells + (t_empty ? 0 : 1) - (t_used ? 1 : 0);
+    if (!block.usedCells)
+        m_blocks.erase(it);
+}
+
+void BrickMap::SetChunk(glm::ivec3 chunkCoord, const Chunk *chunk)
+{
+    for (int bz = 0; bz < BRICKMAP_BLOCK_BRICKS; bz++)
+        for (int by = 0; by < BRICKMAP_BLOCK_BRICKS; by++)
+            for (int bx = 0; bx < BRICKMAP_BLOCK_BRICKS; bx++)
+            {
+                Brick t_bits;
+                for (int x = 0; x < BRICKMAP_BRICK_SIZE; x++)
+                    for (int y = 0; y < BRICKMAP_BRICK_SIZE; y++)
+                        t_bits.columns[x][y] = chunk ? (uint8_t)(chunk->columns[bx * BRICKMAP_BRICK_SIZE + x][by * BRICKMAP_BRICK_SIZE + y] >> (bz * BRICKMAP_BRICK_SIZE)) : 0;
+                storeBrick(chunkCoord * BRICKMAP_BLOCK_BRICKS + glm::ivec3(bx, by, bz), t_bits);
+            }
+}
+
+void BrickMap::Set(glm::ivec3 pos)
+{
+    glm::ivec3 t_brick = brickCoord(pos);
+    glm::ivec3 t_local = pos - t_brick * BRICKMAP_BRICK_SIZE;
+    Brick t_bits = loadBrick(t_brick);
+    t_bits.columns[t_local.x][t_local.y] |= (uint8_t)(1u << t_local.z);
+    storeBrick(t_brick, t_bits);
+}
+
+void BrickMap::Remove(glm::ivec3 pos)
+{
+    glm::ivec3 t_brick = brickCoord(pos);
+    glm::ivec3 t_local = pos - t_brick * BRICKMAP_BRICK_SIZE;
+    Brick t_bits = loadBrick(t_brick);
+    t_bits.columns[t_local.x][t_local.y] &= (uint8_t)~(1u << t_local.z);
+    storeBrick(t_brick, t_bits);
+}
+
+bool BrickMap::Get(glm::ivec3 pos) const
+{
+    glm::ivec3 t_brick = brickCoord(pos);
+    const uint32_t *cell = coarseCell(t_brick);
+    if (!cell || *cell == BRICKMAP_EMPTY)
+        return false;
+    if (*cell == BRICKMAP_SOLID)
+        return true;
+    return isSolid(m_pool[*cell - 1], pos - t_brick * BRICKMAP_BRICK_SIZE);
+}
+
+// Distance along the ray to the far side of cell or brick index, the
+// boundaries are size apart in the shifted space. Recomputed from the index
+// on every step like nextBoundary in castRay, adding up size / dir drifts.
+static inline float nextBoundary(int index, int step, int size, float start, float invDir)
+{
+    return ((float)((index + (step > 0 ? 1 : 0)) * size) - start) * invDir;
+}
+
+// DDA over the bricks of the blocks' bounding box; solid bricks hit where
+// the ray enters them and partly filled bricks are walked cell by cell like
+// castRay does. The block is looked up again only when the ray leaves it.
+RayHit BrickMap::CastRay(glm::vec3 origin, glm::vec3 dir, float maxDistance) const
+{
+    RayHit hit = {false, glm::ivec3(0), glm::ivec3(0), 0.f};
+    float length = glm::length(dir);
+    if (length == 0.f || m_blocks.empty())
+        return hit;
+    dir /= length;
+
+    // cell i covers [i, i + 1) after the shift, brick b covers [8b, 8b + 8)
+    glm::vec3 start = origin + glm::vec3(0.5f);
+    glm::ivec3 t_firstBrick = m_min * BRICKMAP_BLOCK_BRICKS;
+    glm::ivec3 t_lastBrick = (m_max + glm::ivec3(1)) * BRICKMAP_BLOCK_BRICKS - glm::ivec3(1);
+    glm::vec3 t_lo = glm::vec3(m_min * CHUNK_SIZE);
+    glm::vec3 t_hi = glm::vec3((m_max + glm::ivec3(1)) * CHUNK_SIZE);
+    glm::ivec3 step = glm::ivec3(0);
+    glm::vec3 invDir = glm::vec3(std::numeric_limits<float>::infinity());
+    float t = 0.f, tEnd = std::numeric_limits<float>::infinity();
+    int t_entryAxis = -1;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (dir[axis] == 0.f)
+        {
+            if (start[axis] < t_lo[axis] || start[axis] >= t_hi[axis])
+                return hit;
+            continue;
+        }
+        step[axis] = dir[axis] > 0.f ? 1 : -1;
+        invDir[axis] = 1.f / dir[axis];
+        float t1 = (t_lo[axis] - start[axis]) * invDir[axis];
+        float t2 = (t_hi[axis] - start[axis]) * invDir[axis];
+        if (std::min(t1, t2) > t)
+        {
+            t = std::min(t1, t2);
+            t_entryAxis = axis;
+        }
+        tEnd = std::min(tEnd, std::max(t1, t2));
+    }
+    if (t > tEnd || t > maxDistance)
+        return hit;
+
+    glm::ivec3 normal = glm::ivec3(0);
+    if (t_entryAxis >= 0)
+        normal[t_entryAxis] = -step[t_entryAxis];
+    glm::ivec3 brick = glm::ivec3(glm::floor((start + dir * t) / (float)BRICKMAP_BRICK_SIZE));
+    brick = glm::clamp(brick, t_firstBrick, t_lastBrick);
+    glm::vec3 tMax = glm::vec3(std::numeric_limits<float>::infinity());
+    for (int axis = 0; axis < 3; axis++)
+        if (step[axis])
+            tMax[axis] = nextBoundary(brick[axis], step[axis], BRICKMAP_BRICK_SIZE, start[axis], invDir[axis]);
+
+    glm::ivec3 t_blockKey = blockCoord(brick);
+    auto t_block = m_blocks.find(t_blockKey);
+    while (t <= maxDistance)
+    {
+        if (blockCoord(brick) != t_blockKey)
+        {
+            t_blockKey = blockCoord(brick);
+            t_block = m_blocks.find(t_blockKey);
+        }
+        uint32_t t_value = t_block == m_blocks.end() ? BRICKMAP_EMPTY : t_block->second.cells[blockIndex(brick)];
+        if (t_value != BRICKMAP_EMPTY)
+        {
+            glm::ivec3 t_first = brick * BRICKMAP_BRICK_SIZE;
+            glm::ivec3 t_last = t_first + glm::ivec3(BRICKMAP_BRICK_SIZE - 1);
+            glm::ivec3 cell = glm::clamp(glm::ivec3(glm::floor(start + dir * t)), t_first, t_last);
+            if (t_value == BRICKMAP_SOLID)
+            {
+                hit = {true, cell, normal, t};
+                return hit;
+            }
+
+            const Brick &t_brick = m_pool[t_value - 1];
+            glm::vec3 tCell = glm::vec3(std::numeric_limits<float>::infinity());
+            for (int axis = 0; axis < 3; axis++)
+                if (step[axis])
+                    tCell[axis] = nextBoundary(cell[axis], step[axis], 1, start[axis], invDir[axis]);
+            float tInside = t;
+            glm::ivec3 t_normal = normal;
+            while (tInside <= maxDistance)
+            {
+                if (isSolid(t_brick, cell - t_first))
+                {
+                    hit = {true, cell, t_normal, tInside};
+                    return hit;
+                }
+                int axis = tCell.x < tCell.y ? (tCell.x < tCell.z ? 0 : 2) : (tCell.y < tCell.z ? 1 : 2);
+                tInside = tCell[axis];
+                cell[axis] += step[axis];
+                tCell[axis] = nextBoundary(cell[axis], step[axis], 1, start[axis], invDir[axis]);
+                t_normal = glm::ivec3(0);
+                t_normal[axis] = -step[axis];
+                if (cell[axis] < t_first[axis] || cell[axis] > t_last[axis])
+                    break;
+            }
+        }
+
+        int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+        t = tMax[axis];
+        brick[axis] += step[axis];
+        tMax[axis] = nextBoundary(brick[axis], step[axis], BRICKMAP_BRICK_SIZE, start[axis], invDir[axis]);
+        normal = glm::ivec3(0);
+        normal[axis] = -step[axis];
+        if (brick[axis] < t_firstBrick[axis] || brick[axis] > t_lastBrick[axis])
+            break;
+    }
+    return hit;
+}
+
+size_t BrickMap::GetMemoryUsage() const
+{
+    return m_blocks.size() * sizeof(BrickBlock) + m_pool.size() * sizeof(Brick) + m_freeBricks.size() * sizeof(uint32_t);
+}
+
+size_t BrickMap::GetPoolBrickCount() const
+{
+    return m_pool.size() - m_freeBricks.size();
+}
+
+size_t BrickMap::GetSolidBrickCount() const
+{
+    return m_solidBricks;
+}
@@ -0,0 +1,97 @@
+#include "../items/items.hpp"
+#include "../raycast/raycast.hpp"
+#include "../chunk/chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#ifndef BRICKMAP_HPP
+#define BRICKMAP_HPP
+
+// cells per axis of a brick
+#define BRICKMAP_BRICK_SIZE 8
+// bricks per axis of a block, one block covers the cells of one chunk
+#define BRICKMAP_BLOCK_BRICKS (CHUNK_SIZE / BRICKMAP_BRICK_SIZE)
+#define BRICKMAP_BLOCK_CELLS (BRICKMAP_BLOCK_BRICKS * BRICKMAP_BLOCK_BRICKS * BRICKMAP_BLOCK_BRICKS)
+// values of a coarse cell, any other value is 1 + an index into the pool
+#define BRICKMAP_EMPTY 0u
+#define BRICKMAP_SOLID 0xffffffffu // every cell of the brick is set
+
+// Bit z of columns[x][y] is set when cell x, y, z is solid, the layout of
+// Chunk cut down to one brick
+struct Brick
+{
+  uint8_t columns[BRICKMAP_BRICK_SIZE][BRICKMAP_BRICK_SIZE];
+};
+
+// Coarse cells of the bricks inside one chunk, brick x, y, z of the block
+// is cells[x + 4 * (y + 4 * z)]
+struct BrickBlock
+{
+  uint32_t cells[BRICKMAP_BLOCK_CELLS];
+  uint32_t usedCells; // not empty, the block is freed at 0
+};
+
+struct BrickMapBenchmark
+{
+  uint32_t voxelCount;
+  uint32_t rays;    // cast into the brick map
+  uint32_t ddaRays; // the first rays, cast again with castRay
+  size_t poolBricks;
+  size_t solidBricks;
+  size_t bytes;
+  float buildTime;     // ms
+  float brickMapTime;  // us per ray
+  float ddaTime;       // us per ray, castRay on a ChunkMap
+  uint32_t hits;       // of the brick map rays
+  uint32_t ddaDiffs;   // rays where castRay hit another voxel or face
+  uint32_t mismatches; // of those, rays where castRayBruteForce disagrees with the brick map
+};
+
+// Two level occupancy grid: blocks of coarse cells are hashed by chunk
+// coordinate like ChunkMap, so far apart voxels cost one block each, and
+// each coarse cell is empty, solid or a brick of the pool. Rays step over
+// empty and solid bricks in one step and only walk the cells of partly
+// filled bricks. Materials are not stored, callers look the hit voxel up.
+class BrickMap
+{
+public:
+  BrickMap();
+
+  // replaces the bricks of one chunk with its occupancy, null clears them
+  void SetChunk(glm::ivec3 chunkCoord, const Chunk *chunk);
+  void Set(glm::ivec3 pos);
+  void Remove(glm::ivec3 pos);
+  void Clear();
+
+  bool Get(glm::ivec3 pos) const;
+  // same conventions and results as castRay, voxel centres sit on integer
+  // coordinates
+  RayHit CastRay(glm::vec3 origin, glm::vec3 dir, float maxDistance) const;
+
+  size_t GetMemoryUsage() const;
+  size_t GetPoolBrickCount() const; // allocated and not freed
+  size_t GetSolidBrickCount() const;
+
+private:
+  const uint32_t *coarseCell(glm::ivec3 brick) const;
+  Brick loadBrick(glm::ivec3 brick) const;
+  void storeBrick(glm::ivec3 brick, const Brick &bits);
+  uint32_t allocateBrick();
+  void freeBrick(uint32_t index);
+
+  std::unordered_map<glm::ivec3, BrickBlock, ChunkKeyHash> m_blocks;
+  std::vector<Brick> m_pool;
+  std::vector<uint32_t> m_freeBricks;
+  glm::ivec3 m_min, m_max; // block coordinates seen since Clear, rays stop outside
+  size_t m_solidBricks;
+};
+
+// Casts random rays into roughly a million voxels with the brick map and
+// with castRay
+BrickMapBenchmark benchmarkBrickMap();
+
+#endif
@@ -0,0 +1,87 @@
+#include "brickmap.hpp"
+#include "../raycast/ray_benchmark.hpp"
+
+#include <chrono>
+
+#define BRICKMAP_BENCHMARK_SIZE 256
+#define BRICKMAP_BENCHMARK_RADIUS 56
+#define BRICKMAP_BENCHMARK_BALLS 256
+#define BRICKMAP_BENCHMARK_RAYS 1000000
+#define BRICKMAP_BENCHMARK_DDA_RAYS 100000
+
+static bool differ(const RayHit &a, const RayHit &b)
+{
+    return a.hit != b.hit || (a.hit && (a.cell != b.cell || a.normal != b.normal));
+}
+
+BrickMapBenchmark benchmarkBrickMap()
+{
+    BrickMapBenchmark result = {0, BRICKMAP_BENCHMARK_RAYS, BRICKMAP_BENCHMARK_DDA_RAYS, 0, 0, 0, 0.f, 0.f, 0.f, 0, 0, 0};
+
+    // a solid ball in two materials in the middle of a 256^3 grid and
+    // smaller balls scattered around it, about a million voxels
+    std::vector<Voxel> t_voxels;
+    ChunkMap t_occupancy;
+    uint32_t t_seed = 2463534242u;
+    glm::ivec3 t_middle = glm::ivec3(BRICKMAP_BENCHMARK_SIZE / 2);
+    for (int i = 0; i <= BRICKMAP_BENCHMARK_BALLS; i++)
+    {
+        int r = i == 0 ? BRICKMAP_BENCHMARK_RADIUS : 2 + xorshift(t_seed) % 8;
+        uint32_t t_span = BRICKMAP_BENCHMARK_SIZE - 2 * r;
+        glm::ivec3 t_centre = i == 0 ? t_middle
+                                     : glm::ivec3(r) + glm::ivec3(xorshift(t_seed) % t_span, xorshift(t_seed) % t_span, xorshift(t_seed) % t_span);
+        for (int x = -r; x <= r; x++)
+            for (int y = -r; y <= r; y++)
+                for (int z = -r; z <= r; z++)
+                {
+                    glm::ivec3 t_pos = t_centre + glm::ivec3(x, y, z);
+                    if (x * x + y * y + z * z > r * r || t_occupancy.Get(t_pos))
+                        continue;
+                    t_voxels.push_back({glm::i16vec3(t_pos), (MaterialID)(y < 0 ? 0 : 1 + i % 3)});
+                    t_occupancy.Set(t_pos, true);
+                }
+    }
+    result.voxelCount = (uint32_t)t_voxels.size();
+
+    BrickMap t_brickMap;
+    auto t_start = std::chrono::steady_clock::now();
+    for (int x = 0; x < BRICKMAP_BENCHMARK_SIZE / CHUNK_SIZE; x++)
+        for (int y = 0; y < BRICKMAP_BENCHMARK_SIZE / CHUNK_SIZE; y++)
+            for (int z = 0; z < BRICKMAP_BENCHMARK_SIZE / CHUNK_SIZE; z++)
+                t_brickMap.SetChunk(glm::ivec3(x, y, z), t_occupancy.GetChunk(glm::ivec3(x, y, z)));
+    result.buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    result.poolBricks = t_brickMap.GetPoolBrickCount();
+    result.solidBricks = t_brickMap.GetSolidBrickCount();
+    result.bytes = t_brickMap.GetMemoryUsage();
+
+    // rays from a sphere around the grid towards random points inside it
+    BenchmarkRays t_rays = makeBenchmarkRays(t_seed, BRICKMAP_BENCHMARK_RAYS, (float)BRICKMAP_BENCHMARK_SIZE);
+
+    float t_range = BRICKMAP_BENCHMARK_SIZE * 3.f;
+    std::vector<RayHit> t_hits(BRICKMAP_BENCHMARK_RAYS);
+    t_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < BRICKMAP_BENCHMARK_RAYS; i++)
+        t_hits[i] = t_brickMap.CastRay(t_rays.origins[i], t_rays.dirs[i], t_range);
+    result.brickMapTime = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t_start).count() / BRICKMAP_BENCHMARK_RAYS;
+    for (const RayHit &hit : t_hits)
+        if (hit.hit)
+            result.hits++;
+
+    t_start = std::chrono::steady_clock::now();
+    std::vector<RayHit> t_ddaHits(BRICKMAP_BENCHMARK_DDA_RAYS);
+    for (uint32_t i = 0; i < BRICKMAP_BENCHMARK_DDA_RAYS; i++)
+        t_ddaHits[i] = castRay(t_occupancy, t_rays.origins[i], t_rays.dirs[i], t_range);
+    result.ddaTime = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t_start).count() / BRICKMAP_BENCHMARK_DDA_RAYS;
+
+    // both should agree, where they do not the slab test against every
+    // voxel decides which one is wrong
+    for (uint32_t i = 0; i < BRICKMAP_BENCHMARK_DDA_RAYS; i++)
+    {
+        if (!differ(t_hits[i], t_ddaHits[i]))
+            continue;
+        result.ddaDiffs++;
+        if (differ(t_hits[i], castRayBruteForce(t_voxels, t_rays.origins[i], t_rays.dirs[i], t_range)))
+            result.mismatches++;
+    }
+    return result;
+}
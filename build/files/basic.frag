@@ -18,22 +18,27 @@ struct Light {
 
 in vec3 FragPos; 
 in vec3 Normal;
+flat in vec3 MatAmbient;
+flat in vec3 MatDiffuse;
+flat in vec3 MatSpecular;
+flat in float MatShininess;
+in float AmbientOcclusion;
 
 uniform vec3 viewPos;
-uniform Material material;
 uniform Light light;
 
 void main()
 {
+    Material material = Material(MatAmbient, MatDiffuse, MatSpecular, MatShininess);
 
     // ambient
-    vec3 ambient = light.ambient * material.ambient;
+    vec3 ambient = light.ambient * material.ambient * AmbientOcclusion;
 
     // diffuse 
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(-light.direction);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * (diff * material.diffuse);
+    vec3 diffuse = light.diffuse * (diff * material.diffuse) * AmbientOcclusion;
 
     // specular
     vec3 viewDir = normalize(viewPos - FragPos);
@@ -1,17 +1,52 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+// VERTEX_* come from mesher/vertex_layout.hpp, see Shader::Init
+layout (location = 0) in uint aPacked;
+layout (location = 1) in uint aMaterial;
 
 out vec3 FragPos;
 out vec3 Normal;
+flat out vec3 MatAmbient;
+flat out vec3 MatDiffuse;
+flat out vec3 MatSpecular;
+flat out float MatShininess;
+// per-corner occlusion, interpolated across the face
+out float AmbientOcclusion;
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
+// first voxel of the chunk, vertex positions are corners relative to it
+uniform ivec3 chunkOrigin;
+// four texels per material: ambient, diffuse, specular, shininess
+uniform samplerBuffer materials;
+
+// faces ordered right, left, top, bot, front, back
+const vec3 FACE_NORMALS[6] = vec3[6](
+	vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+	vec3(0.0, 1.0, 0.0), vec3(0.0, -1.0, 0.0),
+	vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0));
+
+uint field(uint shift, uint bits)
+{
+	return (aPacked >> shift) & ((1u << bits) - 1u);
+}
 
 void main()
 {
-	FragPos = vec3(model * vec4(aPos, 1.0));
-	Normal = aNormal;
+	ivec3 corner = ivec3(field(uint(VERTEX_X_SHIFT), uint(VERTEX_POSITION_BITS)),
+	                     field(uint(VERTEX_Y_SHIFT), uint(VERTEX_POSITION_BITS)),
+	                     field(uint(VERTEX_Z_SHIFT), uint(VERTEX_POSITION_BITS)));
+	int face = int(field(uint(VERTEX_FACE_SHIFT), uint(VERTEX_FACE_BITS)));
+	AmbientOcclusion = float(field(uint(VERTEX_AO_SHIFT), uint(VERTEX_AO_BITS))) / float(VERTEX_AO_MAX);
+
+	int base = int(aMaterial) * 4;
+	MatAmbient = texelFetch(materials, base).rgb;
+	MatDiffuse = texelFetch(materials, base + 1).rgb;
+	MatSpecular = texelFetch(materials, base + 2).rgb;
+	MatShininess = texelFetch(materials, base + 3).r;
+
+	vec3 pos = vec3(chunkOrigin + corner) - vec3(0.5);
+	FragPos = vec3(model * vec4(pos, 1.0));
+	Normal = FACE_NORMALS[face];
 	gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}
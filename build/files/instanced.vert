@@ -0,0 +1,32 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in ivec3 aOffset;
+layout (location = 3) in uint aMaterial;
+
+out vec3 FragPos;
+out vec3 Normal;
+flat out vec3 MatAmbient;
+flat out vec3 MatDiffuse;
+flat out vec3 MatSpecular;
+flat out float MatShininess;
+out float AmbientOcclusion;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+// four texels per material: ambient, diffuse, specular, shininess
+uniform samplerBuffer materials;
+
+void main()
+{
+	int base = int(aMaterial) * 4;
+	MatAmbient = texelFetch(materials, base).rgb;
+	MatDiffuse = texelFetch(materials, base + 1).rgb;
+	MatSpecular = texelFetch(materials, base + 2).rgb;
+	MatShininess = texelFetch(materials, base + 3).r;
+	AmbientOcclusion = 1.0;
+	FragPos = vec3(model * vec4(aPos + vec3(aOffset), 1.0));
+	Normal = aNormal;
+	gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
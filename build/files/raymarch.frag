@@ -0,0 +1,117 @@
+#version 330 core
+// BRICK_SIZE comes from raymarch/raymarch.hpp, see Shader::Init
+out vec4 FragColor;
+
+struct Material {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+struct Light {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+in vec2 Ndc;
+
+uniform vec3 viewPos;
+uniform Light light;
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+uniform mat4 inverseMvp;
+// material + 1 per cell, 0 is empty
+uniform usampler3D volume;
+// non zero when any cell of the BRICK_SIZE^3 brick is set
+uniform usampler3D bricks;
+// four texels per material: ambient, diffuse, specular, shininess
+uniform samplerBuffer materials;
+// object space voxel of cell 0 and cells per axis
+uniform ivec3 volumeOrigin;
+uniform ivec3 volumeSize;
+
+void main()
+{
+    // the pixel's ray in volume space, where cell c covers [c, c + 1)
+    vec4 nearPoint = inverseMvp * vec4(Ndc, -1.0, 1.0);
+    vec4 farPoint = inverseMvp * vec4(Ndc, 1.0, 1.0);
+    vec3 offset = vec3(volumeOrigin) - vec3(0.5);
+    vec3 origin = nearPoint.xyz / nearPoint.w - offset;
+    vec3 dir = normalize(farPoint.xyz / farPoint.w - nearPoint.xyz / nearPoint.w);
+    dir = mix(dir, vec3(1e-7), lessThan(abs(dir), vec3(1e-7)));
+    vec3 invDir = 1.0 / dir;
+
+    vec3 t1 = -origin * invDir;
+    vec3 t2 = (vec3(volumeSize) - origin) * invDir;
+    vec3 tNear = min(t1, t2);
+    vec3 tFar = max(t1, t2);
+    float t = max(max(tNear.x, tNear.y), max(tNear.z, 0.0));
+    float tEnd = min(min(tFar.x, tFar.y), tFar.z);
+    if (t >= tEnd)
+        discard;
+    // axis of the last boundary crossed, gives the normal of the hit
+    int axis = (tNear.x >= tNear.y && tNear.x >= tNear.z) ? 0 : (tNear.y >= tNear.z ? 1 : 2);
+
+    uint hit = 0u;
+    int steps = volumeSize.x + volumeSize.y + volumeSize.z + 3;
+    for (int i = 0; i < steps && t < tEnd; i++)
+    {
+        // nudged along the ray so a point on a boundary lands in the next cell
+        ivec3 cell = clamp(ivec3(floor(origin + dir * (t + 1e-3))), ivec3(0), volumeSize - 1);
+        vec3 lo;
+        float size;
+        ivec3 brick = cell / BRICK_SIZE;
+        if (texelFetch(bricks, brick, 0).r == 0u)
+        {
+            lo = vec3(brick * BRICK_SIZE);
+            size = float(BRICK_SIZE);
+        }
+        else
+        {
+            hit = texelFetch(volume, cell, 0).r;
+            if (hit != 0u)
+                break;
+            lo = vec3(cell);
+            size = 1.0;
+        }
+        vec3 tExit = (lo + step(0.0, dir) * size - origin) * invDir;
+        axis = (tExit.x <= tExit.y && tExit.x <= tExit.z) ? 0 : (tExit.y <= tExit.z ? 1 : 2);
+        t = tExit[axis];
+    }
+    if (hit == 0u)
+        discard;
+
+    int base = int(hit - 1u) * 4;
+    Material material = Material(texelFetch(materials, base).rgb,
+                                 texelFetch(materials, base + 1).rgb,
+                                 texelFetch(materials, base + 2).rgb,
+                                 texelFetch(materials, base + 3).r);
+    vec3 Normal = vec3(0.0);
+    Normal[axis] = dir[axis] > 0.0 ? -1.0 : 1.0;
+    vec3 FragPos = vec3(model * vec4(origin + dir * t + offset, 1.0));
+    vec4 clip = projection * view * vec4(FragPos, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    // ambient
+    vec3 ambient = light.ambient * material.ambient;
+
+    // diffuse 
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(-light.direction);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = light.diffuse * (diff * material.diffuse);
+
+    // specular
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);  
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    vec3 specular = light.specular * (spec * material.specular);
+
+    vec3 result = (ambient + diffuse + specular);
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,9 @@
+#version 330 core
+out vec2 Ndc;
+
+// one triangle covering the screen, built from the vertex index
+void main()
+{
+	Ndc = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+	gl_Position = vec4(Ndc, 0.0, 1.0);
+}
@@ -0,0 +1,81 @@
+#include "chunk.hpp"
+
+#include <cstring>
+
+glm::ivec3 ChunkMap::ChunkCoord(glm::ivec3 pos)
+{
+    // arithmetic shift rounds towards negative infinity, CHUNK_SIZE is 2^5
+    return glm::ivec3(pos.x >> 5, pos.y >> 5, pos.z >> 5);
+}
+
+glm::ivec3 ChunkMap::LocalCoord(glm::ivec3 pos)
+{
+    return glm::ivec3(pos.x & (CHUNK_SIZE - 1), pos.y & (CHUNK_SIZE - 1), pos.z & (CHUNK_SIZE - 1));
+}
+
+bool ChunkMap::Get(glm::ivec3 pos) const
+{
+    auto it = m_chunks.find(ChunkCoord(pos));
+    if (it == m_chunks.end())
+        return false;
+    glm::ivec3 t_local = LocalCoord(pos);
+    return (it->second->columns[t_local.x][t_local.y] >> t_local.z) & 1u;
+}
+
+const Chunk *ChunkMap::GetChunk(glm::ivec3 chunkCoord) const
+{
+    auto it = m_chunks.find(chunkCoord);
+    if (it == m_chunks.end())
+        return nullptr;
+    return it->second.get();
+}
+
+void ChunkMap::Set(glm::ivec3 pos, bool solid)
+{
+    glm::ivec3 t_key = ChunkCoord(pos);
+    glm::ivec3 t_local = LocalCoord(pos);
+    auto it = m_chunks.find(t_key);
+    if (it == m_chunks.end())
+    {
+        if (!solid)
+            return;
+        std::unique_ptr<Chunk> t_chunk(new Chunk);
+        memset(t_chunk.get(), 0, sizeof(Chunk));
+        it = m_chunks.emplace(t_key, std::move(t_chunk)).first;
+    }
+    Chunk &chunk = *it->second;
+    uint32_t &column = chunk.columns[t_local.x][t_local.y];
+    uint32_t t_bit = 1u << t_local.z;
+    if (solid && !(column & t_bit))
+    {
+        column |= t_bit;
+        chunk.voxelCount++;
+    }
+    else if (!solid && (column & t_bit))
+    {
+        column &= ~t_bit;
+        chunk.voxelCount--;
+        if (chunk.voxelCount == 0)
+            m_chunks.erase(it);
+    }
+}
+
+void ChunkMap::SetChunk(glm::ivec3 chunkCoord, const Chunk &chunk)
+{
+    m_chunks[chunkCoord].reset(new Chunk(chunk));
+}
+
+void ChunkMap::Clear()
+{
+    m_chunks.clear();
+}
+
+size_t ChunkMap::GetChunkCount() const
+{
+    return m_chunks.size();
+}
+
+size_t ChunkMap::GetMemoryUsage() const
+{
+    return m_chunks.size() * sizeof(Chunk);
+}
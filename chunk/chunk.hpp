@@ -0,0 +1,49 @@
+#include "../items/items.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#ifndef CHUNK_HPP
+#define CHUNK_HPP
+
+#define CHUNK_SIZE 32
+
+struct ChunkKeyHash
+{
+  size_t operator()(const glm::ivec3 &key) const
+  {
+    return (size_t)key.x * 73856093u ^ (size_t)key.y * 19349663u ^ (size_t)key.z * 83492791u;
+  }
+};
+
+// Occupancy of a CHUNK_SIZE^3 block of voxels, bit z of columns[x][y] is
+// set when the voxel is solid
+struct Chunk
+{
+  uint32_t columns[CHUNK_SIZE][CHUNK_SIZE];
+  uint32_t voxelCount;
+};
+
+// Sparse voxel occupancy, chunks are allocated when their first voxel is
+// set and freed again when their last voxel is cleared
+class ChunkMap
+{
+public:
+  bool Get(glm::ivec3 pos) const;
+  const Chunk *GetChunk(glm::ivec3 chunkCoord) const;
+  void Set(glm::ivec3 pos, bool solid);
+  void SetChunk(glm::ivec3 chunkCoord, const Chunk &chunk);
+  void Clear();
+  size_t GetChunkCount() const;
+  size_t GetMemoryUsage() const;
+
+  static glm::ivec3 ChunkCoord(glm::ivec3 pos);
+  static glm::ivec3 LocalCoord(glm::ivec3 pos);
+
+private:
+  std::unordered_map<glm::ivec3, std::unique_ptr<Chunk>, ChunkKeyHash> m_chunks;
+};
+
+#endif
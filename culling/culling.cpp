@@ -0,0 +1,98 @@
+#include "culling.hpp"
+#include "../items/simd.hpp"
+
+void BoxList::Add(glm::vec3 min, glm::vec3 max)
+{
+    glm::vec3 t_center = (min + max) * 0.5f;
+    glm::vec3 t_extent = (max - min) * 0.5f;
+    centerX.push_back(t_center.x);
+    centerY.push_back(t_center.y);
+    centerZ.push_back(t_center.z);
+    extentX.push_back(t_extent.x);
+    extentY.push_back(t_extent.y);
+    extentZ.push_back(t_extent.z);
+}
+
+void BoxList::Clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+size_t BoxList::Size() const
+{
+    return centerX.size();
+}
+
+Frustum extractFrustum(const glm::mat4 &viewProjection)
+{
+    // rows of the matrix, glm is column major
+    glm::mat4 t_rows = glm::transpose(viewProjection);
+    Frustum frustum;
+    frustum.planes[0] = t_rows[3] + t_rows[0]; // left
+    frustum.planes[1] = t_rows[3] - t_rows[0]; // right
+    frustum.planes[2] = t_rows[3] + t_rows[1]; // bottom
+    frustum.planes[3] = t_rows[3] - t_rows[1]; // top
+    frustum.planes[4] = t_rows[3] + t_rows[2]; // near
+    frustum.planes[5] = t_rows[3] - t_rows[2]; // far
+    for (glm::vec4 &plane : frustum.planes)
+        plane /= glm::length(glm::vec3(plane));
+    return frustum;
+}
+
+// a box is outside when even its corner furthest along the plane normal
+// is behind the plane
+static inline uint8_t isBoxVisible(const Frustum &frustum, const BoxList &boxes, size_t i)
+{
+    uint8_t t_visible = 1;
+    for (const glm::vec4 &plane : frustum.planes)
+    {
+        float t_distance = plane.x * boxes.centerX[i] + plane.y * boxes.centerY[i] + plane.z * boxes.centerZ[i] + plane.w;
+        float t_radius = glm::abs(plane.x) * boxes.extentX[i] + glm::abs(plane.y) * boxes.extentY[i] + glm::abs(plane.z) * boxes.extentZ[i];
+        t_visible &= (uint8_t)(t_distance + t_radius >= 0.f);
+    }
+    return t_visible;
+}
+
+void cullBoxes(const Frustum &frustum, const BoxList &boxes, std::vector<uint8_t> &visible)
+{
+    size_t t_count = boxes.Size();
+    visible.resize(t_count);
+    size_t i = 0;
+#ifdef SIMD_SSE2
+    // four boxes against all six planes, same operations in the same order
+    // as isBoxVisible so both give the same answer
+    const __m128 t_signBit = _mm_set1_ps(-0.f);
+    __m128 nx[6], ny[6], nz[6], d[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; p++)
+    {
+        nx[p] = _mm_set1_ps(frustum.planes[p].x);
+        ny[p] = _mm_set1_ps(frustum.planes[p].y);
+        nz[p] = _mm_set1_ps(frustum.planes[p].z);
+        d[p] = _mm_set1_ps(frustum.planes[p].w);
+        ax[p] = _mm_andnot_ps(t_signBit, nx[p]);
+        ay[p] = _mm_andnot_ps(t_signBit, ny[p]);
+        az[p] = _mm_andnot_ps(t_signBit, nz[p]);
+    }
+    for (; i + 4 <= t_count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&boxes.centerX[i]), cy = _mm_loadu_ps(&boxes.centerY[i]), cz = _mm_loadu_ps(&boxes.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extentX[i]), ey = _mm_loadu_ps(&boxes.extentY[i]), ez = _mm_loadu_ps(&boxes.extentZ[i]);
+        int t_mask = 0xf;
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 t_distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_mul_ps(nz[p], cz)), d[p]);
+            __m128 t_radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+            t_mask &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(t_distance, t_radius), _mm_setzero_ps()));
+        }
+        for (int k = 0; k < 4; k++)
+            visible[i + k] = (uint8_t)((t_mask >> k) & 1);
+    }
+#endif
+    for (; i < t_count; i++)
+        visible[i] = isBoxVisible(frustum, boxes, i);
+}
@@ -0,0 +1,70 @@
+#include "../chunk/chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 144
+#define OCCLUDER_BLOCK_SIZE 8 // solid blocks of this size become occluders
+#define MAX_OCCLUDERS 512
+
+// Planes point inwards, a point p is inside when dot(plane, vec4(p, 1)) >= 0
+struct Frustum
+{
+  glm::vec4 planes[6];
+};
+
+// Axis aligned boxes as separate arrays so the plane test runs over
+// consecutive floats, cullBoxes tests four boxes per SSE2 register
+struct BoxList
+{
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+
+  void Add(glm::vec3 min, glm::vec3 max);
+  void Clear();
+  size_t Size() const;
+};
+
+struct Box
+{
+  glm::vec3 min;
+  glm::vec3 max;
+};
+
+// Software depth buffer of the occluders with a max depth pyramid on top,
+// boxes are tested against the pyramid level where they cover about 2x2 texels
+class OcclusionBuffer
+{
+public:
+  OcclusionBuffer();
+  void Clear(const glm::mat4 &viewProjection);
+  void AddOccluder(glm::vec3 min, glm::vec3 max);
+  void BuildPyramid();
+  bool IsVisible(glm::vec3 min, glm::vec3 max) const;
+  uint32_t GetOccluderCount() const;
+
+private:
+  bool projectBox(glm::vec3 min, glm::vec3 max, glm::vec3 corners[8]) const;
+  void rasterizeTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+
+  glm::mat4 m_viewProjection;
+  std::vector<std::vector<float>> m_levels; // level 0 is the depth buffer
+  std::vector<glm::ivec2> m_sizes;
+  uint32_t m_occluderCount;
+};
+
+// planes of clip space, for a model matrix in the product they are in object space
+Frustum extractFrustum(const glm::mat4 &viewProjection);
+
+// visible[i] is 1 when box i is at least partly inside the frustum
+void cullBoxes(const Frustum &frustum, const BoxList &boxes, std::vector<uint8_t> &visible);
+
+// Solid OCCLUDER_BLOCK_SIZE^3 blocks of a chunk, merged along z
+void findOccluders(const Chunk &chunk, glm::ivec3 chunkCoord, std::vector<Box> &occluders);
+
+#endif
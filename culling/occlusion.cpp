@@ -0,0 +1,224 @@
+#include "culling.hpp"
+#include "../items/simd.hpp"
+
+#include <algorithm>
+
+// corner i of a box has x from bit 0, y from bit 1 and z from bit 2
+static const int BOX_FACES[6][4] = {
+    {0, 2, 6, 4}, {1, 5, 7, 3}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 1, 3, 2}, {4, 6, 7, 5}};
+
+OcclusionBuffer::OcclusionBuffer()
+{
+    glm::ivec2 t_size = glm::ivec2(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+    while (true)
+    {
+        m_sizes.push_back(t_size);
+        m_levels.push_back(std::vector<float>((size_t)t_size.x * t_size.y, 1.f));
+        if (t_size.x == 1 && t_size.y == 1)
+            break;
+        t_size = glm::max((t_size + glm::ivec2(1)) / 2, glm::ivec2(1));
+    }
+    m_viewProjection = glm::mat4(1.f);
+    m_occluderCount = 0;
+}
+
+void OcclusionBuffer::Clear(const glm::mat4 &viewProjection)
+{
+    m_viewProjection = viewProjection;
+    std::fill(m_levels[0].begin(), m_levels[0].end(), 1.f);
+    m_occluderCount = 0;
+}
+
+// corners in pixels with depth in [0, 1], false when the box reaches
+// behind the near plane
+bool OcclusionBuffer::projectBox(glm::vec3 min, glm::vec3 max, glm::vec3 corners[8]) const
+{
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 t_corner = glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+        glm::vec4 t_clip = m_viewProjection * glm::vec4(t_corner, 1.f);
+        if (t_clip.w <= 1e-5f || t_clip.z < -t_clip.w)
+            return false;
+        glm::vec3 t_ndc = glm::vec3(t_clip) / t_clip.w;
+        corners[i] = glm::vec3((t_ndc.x * 0.5f + 0.5f) * OCCLUSION_WIDTH,
+                               (t_ndc.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT,
+                               t_ndc.z * 0.5f + 0.5f);
+    }
+    return true;
+}
+
+void OcclusionBuffer::AddOccluder(glm::vec3 min, glm::vec3 max)
+{
+    glm::vec3 t_corners[8];
+    if (!projectBox(min, max, t_corners))
+        return;
+    m_occluderCount++;
+    for (const int *face : BOX_FACES)
+    {
+        rasterizeTriangle(t_corners[face[0]], t_corners[face[1]], t_corners[face[2]]);
+        rasterizeTriangle(t_corners[face[0]], t_corners[face[2]], t_corners[face[3]]);
+    }
+}
+
+void OcclusionBuffer::rasterizeTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+    float t_area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (t_area == 0.f)
+        return;
+    if (t_area < 0.f)
+    {
+        std::swap(b, c);
+        t_area = -t_area;
+    }
+
+    int t_minX = std::max((int)glm::floor(glm::min(a.x, glm::min(b.x, c.x))), 0);
+    int t_maxX = std::min((int)glm::ceil(glm::max(a.x, glm::max(b.x, c.x))), OCCLUSION_WIDTH - 1);
+    int t_minY = std::max((int)glm::floor(glm::min(a.y, glm::min(b.y, c.y))), 0);
+    int t_maxY = std::min((int)glm::ceil(glm::max(a.y, glm::max(b.y, c.y))), OCCLUSION_HEIGHT - 1);
+    if (t_minX > t_maxX || t_minY > t_maxY)
+        return;
+
+    // edge functions and depth are linear in x, so a row is four pixels per
+    // SSE2 step and a scalar loop for the rest, both compute the same values
+    float t_invArea = 1.f / t_area;
+    float A0 = b.y - c.y, B0 = c.x - b.x, C0 = b.x * c.y - b.y * c.x;
+    float A1 = c.y - a.y, B1 = a.x - c.x, C1 = c.x * a.y - c.y * a.x;
+    float A2 = a.y - b.y, B2 = b.x - a.x, C2 = a.x * b.y - a.y * b.x;
+    float zA = (A0 * a.z + A1 * b.z + A2 * c.z) * t_invArea;
+    float zB = (B0 * a.z + B1 * b.z + B2 * c.z) * t_invArea;
+    float zC = (C0 * a.z + C1 * b.z + C2 * c.z) * t_invArea;
+
+    std::vector<float> &depth = m_levels[0];
+    int t_width = t_maxX - t_minX + 1;
+#ifdef SIMD_SSE2
+    const __m128 t_lanes = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    const __m128 t_zero = _mm_setzero_ps();
+    __m128 vA0 = _mm_set1_ps(A0), vA1 = _mm_set1_ps(A1), vA2 = _mm_set1_ps(A2), vzA = _mm_set1_ps(zA);
+#endif
+    for (int y = t_minY; y <= t_maxY; y++)
+    {
+        float px = t_minX + 0.5f;
+        float py = y + 0.5f;
+        float e0 = A0 * px + B0 * py + C0;
+        float e1 = A1 * px + B1 * py + C1;
+        float e2 = A2 * px + B2 * py + C2;
+        float z = zA * px + zB * py + zC;
+        float *row = &depth[(size_t)y * OCCLUSION_WIDTH + t_minX];
+        int i = 0;
+#ifdef SIMD_SSE2
+        __m128 ve0 = _mm_set1_ps(e0), ve1 = _mm_set1_ps(e1), ve2 = _mm_set1_ps(e2), vz = _mm_set1_ps(z);
+        for (; i + 4 <= t_width; i += 4)
+        {
+            __m128 t_i = _mm_add_ps(_mm_set1_ps((float)i), t_lanes);
+            __m128 w0 = _mm_add_ps(ve0, _mm_mul_ps(vA0, t_i));
+            __m128 w1 = _mm_add_ps(ve1, _mm_mul_ps(vA1, t_i));
+            __m128 w2 = _mm_add_ps(ve2, _mm_mul_ps(vA2, t_i));
+            __m128 t_z = _mm_add_ps(vz, _mm_mul_ps(vzA, t_i));
+            __m128 t_old = _mm_loadu_ps(row + i);
+            __m128 t_inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, t_zero), _mm_cmpge_ps(w1, t_zero)),
+                                         _mm_and_ps(_mm_cmpge_ps(w2, t_zero), _mm_cmplt_ps(t_z, t_old)));
+            _mm_storeu_ps(row + i, _mm_or_ps(_mm_and_ps(t_inside, t_z), _mm_andnot_ps(t_inside, t_old)));
+        }
+#endif
+        for (; i < t_width; i++)
+        {
+            float w0 = e0 + A0 * i;
+            float w1 = e1 + A1 * i;
+            float w2 = e2 + A2 * i;
+            float t_z = z + zA * i;
+            bool t_inside = (w0 >= 0.f) & (w1 >= 0.f) & (w2 >= 0.f) & (t_z < row[i]);
+            row[i] = t_inside ? t_z : row[i];
+        }
+    }
+}
+
+void OcclusionBuffer::BuildPyramid()
+{
+    for (size_t level = 1; level < m_levels.size(); level++)
+    {
+        glm::ivec2 t_src = m_sizes[level - 1];
+        glm::ivec2 t_dst = m_sizes[level];
+        const std::vector<float> &src = m_levels[level - 1];
+        std::vector<float> &dst = m_levels[level];
+        for (int y = 0; y < t_dst.y; y++)
+        {
+            int y0 = y * 2;
+            int y1 = std::min(y0 + 1, t_src.y - 1);
+            for (int x = 0; x < t_dst.x; x++)
+            {
+                int x0 = x * 2;
+                int x1 = std::min(x0 + 1, t_src.x - 1);
+                dst[(size_t)y * t_dst.x + x] = std::max(std::max(src[(size_t)y0 * t_src.x + x0], src[(size_t)y0 * t_src.x + x1]),
+                                                        std::max(src[(size_t)y1 * t_src.x + x0], src[(size_t)y1 * t_src.x + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(glm::vec3 min, glm::vec3 max) const
+{
+    glm::vec3 t_corners[8];
+    if (!projectBox(min, max, t_corners))
+        return true;
+
+    glm::vec3 t_min = t_corners[0];
+    glm::vec3 t_max = t_corners[0];
+    for (int i = 1; i < 8; i++)
+    {
+        t_min = glm::min(t_min, t_corners[i]);
+        t_max = glm::max(t_max, t_corners[i]);
+    }
+    int x0 = std::max((int)glm::floor(t_min.x), 0);
+    int y0 = std::max((int)glm::floor(t_min.y), 0);
+    int x1 = std::min((int)glm::floor(t_max.x), OCCLUSION_WIDTH - 1);
+    int y1 = std::min((int)glm::floor(t_max.y), OCCLUSION_HEIGHT - 1);
+    if (x0 > x1 || y0 > y1)
+        return true; // off screen, left to the frustum test
+
+    size_t level = 0;
+    while (level + 1 < m_levels.size() && std::max(x1 - x0, y1 - y0) >> level > 1)
+        level++;
+    glm::ivec2 t_size = m_sizes[level];
+    const std::vector<float> &depth = m_levels[level];
+    for (int y = y0 >> level; y <= (y1 >> level); y++)
+        for (int x = x0 >> level; x <= (x1 >> level); x++)
+            if (t_min.z <= depth[(size_t)y * t_size.x + x])
+                return true;
+    return false;
+}
+
+uint32_t OcclusionBuffer::GetOccluderCount() const
+{
+    return m_occluderCount;
+}
+
+void findOccluders(const Chunk &chunk, glm::ivec3 chunkCoord, std::vector<Box> &occluders)
+{
+    const int t_blocks = CHUNK_SIZE / OCCLUDER_BLOCK_SIZE;
+    const uint32_t t_blockMask = (1u << OCCLUDER_BLOCK_SIZE) - 1;
+    glm::vec3 t_origin = glm::vec3(chunkCoord * CHUNK_SIZE) - glm::vec3(0.5f);
+    for (int bx = 0; bx < t_blocks; bx++)
+        for (int by = 0; by < t_blocks; by++)
+        {
+            // z bits that are solid in every column of this footprint
+            uint32_t t_solid = ~0u;
+            for (int x = 0; x < OCCLUDER_BLOCK_SIZE; x++)
+                for (int y = 0; y < OCCLUDER_BLOCK_SIZE; y++)
+                    t_solid &= chunk.columns[bx * OCCLUDER_BLOCK_SIZE + x][by * OCCLUDER_BLOCK_SIZE + y];
+
+            int t_start = -1;
+            for (int bz = 0; bz <= t_blocks; bz++)
+            {
+                bool t_full = bz < t_blocks && ((t_solid >> (bz * OCCLUDER_BLOCK_SIZE)) & t_blockMask) == t_blockMask;
+                if (t_full && t_start < 0)
+                    t_start = bz;
+                if (!t_full && t_start >= 0)
+                {
+                    glm::vec3 t_min = t_origin + glm::vec3(bx, by, t_start) * (float)OCCLUDER_BLOCK_SIZE;
+                    glm::vec3 t_max = t_origin + glm::vec3(bx + 1, by + 1, bz) * (float)OCCLUDER_BLOCK_SIZE;
+                    occluders.push_back({t_min, t_max});
+                    t_start = -1;
+                }
+            }
+        }
+}
@@ -40,14 +40,9 @@ void loadVertexBuffer(std::vector<Vertex> &vert)
     return;
   }
   Vertex t_vert;
-  while (!file.eof())
+  while (file >> t_vert.pos.x >> t_vert.pos.y >> t_vert.pos.z >>
+         t_vert.normals.x >> t_vert.normals.y >> t_vert.normals.z)
   {
-    file >> t_vert.pos.x;
-    file >> t_vert.pos.y;
-    file >> t_vert.pos.z;
-    file >> t_vert.normals.x;
-    file >> t_vert.normals.y;
-    file >> t_vert.normals.z;
     vert.push_back(t_vert);
   }
   file.close();
@@ -62,9 +57,8 @@ void loadIndexBuffer(std::vector<uint32_t> &ind)
     return;
   }
   uint32_t t_ind;
-  while (!file.eof())
+  while (file >> t_ind)
   {
-    file >> t_ind;
     ind.push_back(t_ind);
   }
   file.close();
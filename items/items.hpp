@@ -1,4 +1,6 @@
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <cstdint>
 #include <iostream>
 
 #ifndef ITEMS_H
@@ -11,7 +13,9 @@
 #define GLSL_VERTEX_FILE_EXTENSION ".vert"
 #define MATERIAL_FILE_EXTENSION ".mat"
 #define VOXEL_FILE_EXTENSION ".vxl"
+#define VOXEL_TEXT_FILE_EXTENSION ".txt"
 #define CONFIG_FILE_EXTENSION ".config"
+#define REGION_FILE_EXTENSION ".region"
 #define SCR_WIDTH 1280
 #define SCR_HEIGHT 720
 #define APPLICATION_NAME "Voxel Editor"
@@ -19,6 +23,10 @@
 
 #define VOXEL_COUNT 255
 #define MAX_RAY_RANGE 100.f
+#define PAGING_RADIUS 4         // chunks around the camera kept resident
+#define MAX_RESIDENT_CHUNKS 512 // far chunks are evicted above this
+#define LOD_LEVELS 4            // full, 1/2, 1/4 and 1/8 resolution
+#define LOD_DISTANCE 96.f       // each level is used up to twice as far as the last
 
 struct Vertex
 {
@@ -35,10 +43,13 @@ struct Material
   float shininess;
 };
 
+// index into the material palette, see registerMaterial
+typedef uint16_t MaterialID;
+
 struct Voxel
 {
-  glm::vec3 pos;
-  Material mat;
+  glm::i16vec3 pos;
+  MaterialID mat;
 };
 
 struct MVP
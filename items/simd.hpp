@@ -0,0 +1,20 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// SIMD paths picked at compile time. SSE2 is part of every x86-64 target,
+// AVX2 only with -mavx2 (/arch:AVX2, the VOXEL_AVX2 CMake option); other
+// targets use the scalar loops
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#define SIMD_SSE2
+#define SIMD_PATH "AVX2"
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#define SIMD_PATH "SSE2"
+#else
+#define SIMD_PATH "scalar"
+#endif
+
+#endif
@@ -0,0 +1,115 @@
+#include "job_system.hpp"
+
+// index of the worker running on this thread, -1 outside of the pool
+static thread_local int t_workerIndex = -1;
+
+JobSystem::JobSystem(unsigned threadCount)
+{
+    if (threadCount == 0)
+        threadCount = 1;
+    m_pendingJobs = 0;
+    m_queuedJobs = 0;
+    m_nextWorker = 0;
+    m_running = true;
+    for (unsigned i = 0; i < threadCount; i++)
+        m_workers.emplace_back(new Worker);
+    for (unsigned i = 0; i < threadCount; i++)
+        m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_running = false;
+    }
+    m_wake.notify_all();
+    for (std::thread &thread : m_threads)
+        thread.join();
+}
+
+void JobSystem::Submit(std::function<void()> job)
+{
+    // jobs spawned by a worker stay on its deque, others are spread round robin
+    unsigned t_index = t_workerIndex >= 0 ? (unsigned)t_workerIndex
+                                          : m_nextWorker++ % (unsigned)m_workers.size();
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_pendingJobs++;
+        m_queuedJobs++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_workers[t_index]->mutex);
+        m_workers[t_index]->jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void JobSystem::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_done.wait(lock, [this]
+                { return m_pendingJobs == 0; });
+}
+
+unsigned JobSystem::GetThreadCount()
+{
+    return (unsigned)m_threads.size();
+}
+
+bool JobSystem::popJob(unsigned index, std::function<void()> &job)
+{
+    {
+        Worker &worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.jobs.empty())
+        {
+            job = std::move(worker.jobs.back());
+            worker.jobs.pop_back();
+            m_queuedJobs--;
+            return true;
+        }
+    }
+    for (size_t i = 1; i < m_workers.size(); i++)
+    {
+        Worker &victim = *m_workers[(index + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty())
+        {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            m_queuedJobs--;
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobSystem::workerLoop(unsigned index)
+{
+    t_workerIndex = (int)index;
+    std::function<void()> job;
+    while (true)
+    {
+        if (popJob(index, job))
+        {
+            job();
+            job = nullptr;
+            if (--m_pendingJobs == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_wakeMutex);
+                m_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        if (!m_running)
+            return;
+        // a job may have been queued between popJob and taking the lock,
+        // m_queuedJobs already counts it so the wakeup is not lost
+        m_wake.wait(lock, [this]
+                    { return !m_running || m_queuedJobs > 0; });
+    }
+}
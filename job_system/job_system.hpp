@@ -0,0 +1,46 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+// Thread pool where every worker owns a job deque. Workers take their own
+// jobs from the back and steal from the front of other workers when idle.
+class JobSystem
+{
+public:
+  JobSystem(unsigned threadCount = std::thread::hardware_concurrency());
+  ~JobSystem();
+  void Submit(std::function<void()> job);
+  void Wait(); // must not be called from a job
+  unsigned GetThreadCount();
+
+private:
+  struct Worker
+  {
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+  };
+
+  void workerLoop(unsigned index);
+  bool popJob(unsigned index, std::function<void()> &job);
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<std::thread> m_threads;
+  std::atomic<uint32_t> m_pendingJobs; // submitted and not finished
+  std::atomic<uint32_t> m_queuedJobs;  // submitted and not started
+  std::atomic<uint32_t> m_nextWorker;
+  bool m_running;
+  std::mutex m_wakeMutex;
+  std::condition_variable m_wake;
+  std::condition_variable m_done;
+};
+
+#endif
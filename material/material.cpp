@@ -1,5 +1,11 @@
 #include "material.hpp"
 
+// materials already read from files/, keyed by name
+static std::unordered_map<std::string, Material> s_materialCache;
+static std::vector<Material> s_palette;
+static std::unordered_map<std::string, MaterialID> s_paletteIDs;
+static uint32_t s_paletteVersion = 0;
+
 void saveMaterial(Material mat, const std::string &matName, bool edit)
 {
 	std::cout << "MATERIAL::SAVE_MATERIAL ";
@@ -17,6 +23,7 @@ void saveMaterial(Material mat, const std::string &matName, bool edit)
 	file << mat.specular[0] << " " << mat.specular[1] << " " << mat.specular[2] << std::endl;
 	file << mat.shininess;
 	file.close();
+	invalidateMaterial(matName);
 	if (edit)
 	{
 		std::cout << "EDIT_MODE ";
@@ -44,6 +51,7 @@ void removeMaterial(const std::string &matName)
 	std::string matPath = std::string(FILES_PATH) + matName + MATERIAL_FILE_EXTENSION;
 	std::cout << "MATERIAL::REMOVE_MATERIAL ";
 	std::cout << matPath << " ";
+	invalidateMaterial(matName);
 	if (remove(matPath.c_str()))
 	{
 		std::cout << "REMOVE_FAILED" << std::endl;
@@ -54,10 +62,15 @@ void removeMaterial(const std::string &matName)
 
 Material loadMaterial(const std::string &matName)
 {
+	auto it = s_materialCache.find(matName);
+	if (it != s_materialCache.end())
+		return it->second;
+
 	std::cout << "MATERIAL::LOAD_MATERIAL ";
 	std::cout << std::string(FILES_PATH) + matName + MATERIAL_FILE_EXTENSION << " ";
 	std::ifstream file(std::string(FILES_PATH) + matName + MATERIAL_FILE_EXTENSION);
-	if (file.bad() || file.fail())
+	bool t_bad = file.bad() || file.fail();
+	if (t_bad)
 	{
 		std::cout << "FILE_BAD" << std::endl;
 	}
@@ -72,9 +85,16 @@ Material loadMaterial(const std::string &matName)
 	file >> t_mat.shininess;
 	file.close();
 	std::cout << std::endl;
+	if (!t_bad)
+		s_materialCache[matName] = t_mat;
 	return t_mat;
 }
 
+void invalidateMaterial(const std::string &matName)
+{
+	s_materialCache.erase(matName);
+}
+
 std::vector<std::string> loadMaterialNames()
 {
 	std::cout << "MATERIAL::LOAD_MATERIAL_NAMES ";
@@ -123,3 +143,52 @@ std::vector<Material> loadMaterialsfromFile()
 	std::cout << std::endl;
 	return t_materials;
 }
+
+MaterialID registerMaterial(const Material &mat)
+{
+	auto it = s_paletteIDs.find(mat.name);
+	if (it != s_paletteIDs.end())
+	{
+		Material &t_entry = s_palette[it->second];
+		if (t_entry.ambient != mat.ambient || t_entry.diffuse != mat.diffuse ||
+			t_entry.specular != mat.specular || t_entry.shininess != mat.shininess)
+			s_paletteVersion++;
+		t_entry = mat;
+		return it->second;
+	}
+	MaterialID t_id = (MaterialID)s_palette.size();
+	s_palette.push_back(mat);
+	s_paletteVersion++;
+	s_paletteIDs[mat.name] = t_id;
+	std::cout << "MATERIAL::REGISTER_MATERIAL " << mat.name << " " << t_id << std::endl;
+	return t_id;
+}
+
+const Material &getMaterial(MaterialID id)
+{
+	return s_palette[id];
+}
+
+std::vector<Material> getMaterialPalette()
+{
+	return s_palette;
+}
+
+uint32_t getMaterialPaletteVersion()
+{
+	return s_paletteVersion;
+}
+
+std::vector<glm::vec4> packMaterialPalette(const std::vector<Material> &materials)
+{
+	std::vector<glm::vec4> t_palette;
+	t_palette.reserve(materials.size() * 4);
+	for (const Material &mat : materials)
+	{
+		t_palette.push_back(glm::vec4(mat.ambient, 1.f));
+		t_palette.push_back(glm::vec4(mat.diffuse, 1.f));
+		t_palette.push_back(glm::vec4(mat.specular, 1.f));
+		t_palette.push_back(glm::vec4(mat.shininess * 128));
+	}
+	return t_palette;
+}
@@ -3,6 +3,7 @@
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
 
 #ifndef MATERIAL_HPP
 #define MATERIAL_HPP
@@ -11,10 +12,30 @@ void saveMaterial(Material mat, const std::string &matName, bool edit = false);
 
 void removeMaterial(const std::string &matName);
 
+// Reads files/<matName>.mat on first use, later calls are served from memory
 Material loadMaterial(const std::string &matName);
 
+// Drops the cached copy so the next loadMaterial reads the file again,
+// saveMaterial and removeMaterial call it
+void invalidateMaterial(const std::string &matName);
+
 std::vector<std::string> loadMaterialNames();
 
 std::vector<Material> loadMaterialsfromFile();
 
+// Palette of materials used by voxels, registering a name again updates its
+// data and keeps the ID
+MaterialID registerMaterial(const Material &mat);
+
+const Material &getMaterial(MaterialID id);
+
+std::vector<Material> getMaterialPalette();
+
+// Changes whenever a palette entry is added or its data changes
+uint32_t getMaterialPaletteVersion();
+
+// Four texels per material as the shaders fetch them: ambient, diffuse,
+// specular, then shininess scaled to the Phong exponent
+std::vector<glm::vec4> packMaterialPalette(const std::vector<Material> &materials);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "mesher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Voxels are meshed in the same blocks as the chunk map, together with one
+// voxel of padding on each side every column of a block fits in a uint64
+#define BINARY_BLOCK_SIZE CHUNK_SIZE
+#define BINARY_PADDED_SIZE (CHUNK_SIZE + 2)
+#define BINARY_INTERIOR_MASK (((1ull << BINARY_BLOCK_SIZE) - 1) << 1)
+
+static inline int countTrailingZeros(uint64_t bits)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+static inline int popCount(uint64_t bits)
+{
+#ifdef _MSC_VER
+    return (int)__popcnt64(bits);
+#else
+    return __builtin_popcountll(bits);
+#endif
+}
+
+// Occupancy of one padded block, cols[axis][u + 34 * v] holds the voxels
+// along axis with u = (axis + 1) % 3 and v = (axis + 2) % 3
+struct BinaryBlock
+{
+    uint64_t cols[3][BINARY_PADDED_SIZE * BINARY_PADDED_SIZE];
+};
+
+static inline void setCell(BinaryBlock &block, glm::ivec3 p)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        block.cols[axis][p[u] + BINARY_PADDED_SIZE * p[v]] |= 1ull << p[axis];
+    }
+}
+
+// Visible faces of one direction of a block, see buildBinaryMesh
+struct FacePlanes
+{
+    uint64_t rows[BINARY_BLOCK_SIZE][BINARY_BLOCK_SIZE];
+    uint32_t keys[BINARY_BLOCK_SIZE][BINARY_BLOCK_SIZE][BINARY_BLOCK_SIZE];
+};
+
+// faces ordered right, left, top, bot, front, back like in mesher.cpp
+static inline uint64_t visibleFaces(uint64_t col, int face)
+{
+    uint64_t t_neighbours = (face % 2 == 0) ? col >> 1 : col << 1;
+    return col & ~t_neighbours & BINARY_INTERIOR_MASK;
+}
+
+static inline int floorDiv(int a, int b)
+{
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+// packs a padded block position and a material index into one entry
+static inline uint64_t packCell(glm::ivec3 p, MaterialID mat)
+{
+    return (uint64_t)p.x | (uint64_t)p.y << 6 | (uint64_t)p.z << 12 | (uint64_t)mat << 18;
+}
+
+// Sets the padding of a block from the six neighbouring chunks, corner AO
+// also needs the twenty edge and corner neighbours
+static void setPadding(BinaryBlock &block, const ChunkMap &occupancy, glm::ivec3 chunkCoord,
+                       bool edges)
+{
+    for (int dx = -1; dx <= 1; dx++)
+        for (int dy = -1; dy <= 1; dy++)
+            for (int dz = -1; dz <= 1; dz++)
+            {
+                glm::ivec3 t_offset = glm::ivec3(dx, dy, dz);
+                int t_sides = (dx != 0) + (dy != 0) + (dz != 0);
+                if (t_sides == 0 || (t_sides > 1 && !edges))
+                    continue;
+                const Chunk *t_chunk = occupancy.GetChunk(chunkCoord + t_offset);
+                if (!t_chunk)
+                    continue;
+                // local cells of the neighbour that touch this block
+                glm::ivec3 t_min, t_max;
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    t_min[axis] = t_offset[axis] < 0 ? BINARY_BLOCK_SIZE - 1 : 0;
+                    t_max[axis] = t_offset[axis] > 0 ? 0 : BINARY_BLOCK_SIZE - 1;
+                }
+                glm::ivec3 t_local;
+                for (t_local.x = t_min.x; t_local.x <= t_max.x; t_local.x++)
+                    for (t_local.y = t_min.y; t_local.y <= t_max.y; t_local.y++)
+                        for (t_local.z = t_min.z; t_local.z <= t_max.z; t_local.z++)
+                        {
+                            if (!((t_chunk->columns[t_local.x][t_local.y] >> t_local.z) & 1u))
+                                continue;
+                            setCell(block, t_local + t_offset * BINARY_BLOCK_SIZE + glm::ivec3(1));
+                        }
+            }
+}
+
+// Corner AO of every face in one column, two bit planes per corner in
+// emitQuad order. The eight columns around this one are shifted so that
+// bit s holds the cell in front of a face in slice s, then each corner is
+// 3 - (side1 + side2 + corner) or 0 when both sides are solid, the same
+// rule as AoSampler::FaceAO.
+struct ColumnAO
+{
+    uint64_t low[4];
+    uint64_t high[4];
+
+    uint32_t Face(int slice) const
+    {
+        uint32_t result = 0;
+        for (int i = 0; i < 4; i++)
+            result |= (uint32_t)(((low[i] >> slice) & 1) | ((high[i] >> slice) & 1) << 1) << (i * 2);
+        return result;
+    }
+};
+
+static inline ColumnAO columnAO(const BinaryBlock &block, int face, int i, int j)
+{
+    int axis = face / 2;
+    uint64_t t_around[3][3];
+    for (int dv = -1; dv <= 1; dv++)
+        for (int du = -1; du <= 1; du++)
+        {
+            uint64_t t_col = block.cols[axis][(i + du) + BINARY_PADDED_SIZE * (j + dv)];
+            t_around[du + 1][dv + 1] = (face % 2 == 0) ? t_col >> 1 : t_col << 1;
+        }
+
+    const int corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    ColumnAO result;
+    for (int k = 0; k < 4; k++)
+    {
+        uint64_t t_side1 = t_around[corners[k][0] + 1][1];
+        uint64_t t_side2 = t_around[1][corners[k][1] + 1];
+        uint64_t t_corner = t_around[corners[k][0] + 1][corners[k][1] + 1];
+        // with at most one side solid the sum fits in two bits and 3 - sum
+        // is its complement
+        uint64_t t_visible = ~(t_side1 & t_side2);
+        result.low[k] = ~(t_side1 ^ t_side2 ^ t_corner) & t_visible;
+        result.high[k] = ~((t_side1 | t_side2) & t_corner) & t_visible;
+    }
+    return result;
+}
+
+MeshStats buildBinaryMesh(const std::vector<Voxel> &voxels, const ChunkMap &occupancy,
+                          glm::ivec3 origin, bool ambientOcclusion,
+                          std::vector<MeshVertex> &vertices, std::vector<uint32_t> &indices)
+{
+    MeshStats stats = {0, 0, 0.f};
+
+    // interior cells of every block, padding comes from the chunk map
+    std::map<std::tuple<int, int, int>, std::vector<uint64_t>> blocks;
+    for (const Voxel &voxel : voxels)
+    {
+        glm::ivec3 t_pos = glm::ivec3(voxel.pos);
+        glm::ivec3 t_block = ChunkMap::ChunkCoord(t_pos);
+        glm::ivec3 t_padded = ChunkMap::LocalCoord(t_pos) + glm::ivec3(1);
+        blocks[std::make_tuple(t_block.x, t_block.y, t_block.z)].push_back(packCell(t_padded, voxel.mat));
+    }
+
+    std::unique_ptr<BinaryBlock> block(new BinaryBlock);
+    std::vector<MaterialID> cellMaterials(BINARY_PADDED_SIZE * BINARY_PADDED_SIZE * BINARY_PADDED_SIZE);
+    // faces of one direction, bit u of rows[slice][v] is a face and
+    // keys[slice][v][u] its material | AO << 16. Runs only merge faces with
+    // the same key, so faces with different corner AO never merge.
+    std::unique_ptr<FacePlanes> planes(new FacePlanes);
+
+    for (auto &entry : blocks)
+    {
+        glm::ivec3 t_blockOrigin = glm::ivec3(std::get<0>(entry.first), std::get<1>(entry.first), std::get<2>(entry.first)) * BINARY_BLOCK_SIZE;
+        memset(block.get(), 0, sizeof(BinaryBlock));
+        setPadding(*block, occupancy, t_blockOrigin / BINARY_BLOCK_SIZE, ambientOcclusion);
+        for (uint64_t t_cell : entry.second)
+        {
+            glm::ivec3 p = glm::ivec3(t_cell & 63, (t_cell >> 6) & 63, (t_cell >> 12) & 63);
+            setCell(*block, p);
+            cellMaterials[(p.x * BINARY_PADDED_SIZE + p.y) * BINARY_PADDED_SIZE + p.z] = (MaterialID)(t_cell >> 18);
+        }
+
+        for (int face = 0; face < 6; face++)
+        {
+            int axis = face / 2;
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            memset(planes->rows, 0, sizeof(planes->rows));
+            uint64_t t_slices = 0;
+            for (int j = 1; j <= BINARY_BLOCK_SIZE; j++)
+                for (int i = 1; i <= BINARY_BLOCK_SIZE; i++)
+                {
+                    uint64_t t_bits = visibleFaces(block->cols[axis][i + BINARY_PADDED_SIZE * j], face);
+                    stats.visibleFaces += popCount(t_bits);
+                    t_slices |= t_bits;
+                    ColumnAO t_columnAO;
+                    if (ambientOcclusion && t_bits)
+                        t_columnAO = columnAO(*block, face, i, j);
+                    while (t_bits)
+                    {
+                        int t_slice = countTrailingZeros(t_bits);
+                        t_bits &= t_bits - 1;
+                        glm::ivec3 p;
+                        p[axis] = t_slice;
+                        p[u] = i;
+                        p[v] = j;
+                        uint32_t t_key = cellMaterials[(p.x * BINARY_PADDED_SIZE + p.y) * BINARY_PADDED_SIZE + p.z];
+                        uint32_t t_ao = ambientOcclusion ? t_columnAO.Face(t_slice) : AO_NONE;
+                        planes->rows[t_slice - 1][j - 1] |= 1ull << (i - 1);
+                        planes->keys[t_slice - 1][j - 1][i - 1] = t_key | t_ao << 16;
+                    }
+                }
+
+            // greedy merge, runs along u are found with ctz and cut at the
+            // first different key, then grown along v while the next row
+            // holds the whole run with the same key
+            while (t_slices)
+            {
+                int t_slice = countTrailingZeros(t_slices);
+                t_slices &= t_slices - 1;
+                uint64_t *rows = planes->rows[t_slice - 1];
+                uint32_t(*keys)[BINARY_BLOCK_SIZE] = planes->keys[t_slice - 1];
+                for (int row = 0; row < BINARY_BLOCK_SIZE; row++)
+                {
+                    while (rows[row])
+                    {
+                        int t_start = countTrailingZeros(rows[row]);
+                        uint32_t t_key = keys[row][t_start];
+                        int w = 1;
+                        while (t_start + w < BINARY_BLOCK_SIZE && ((rows[row] >> (t_start + w)) & 1) &&
+                               keys[row][t_start + w] == t_key)
+                            w++;
+                        uint64_t t_run = ((1ull << w) - 1) << t_start;
+                        rows[row] &= ~t_run;
+                        int h = 1;
+                        while (row + h < BINARY_BLOCK_SIZE && (rows[row + h] & t_run) == t_run &&
+                               std::all_of(keys[row + h] + t_start, keys[row + h] + t_start + w,
+                                           [t_key](uint32_t key) { return key == t_key; }))
+                        {
+                            rows[row + h] &= ~t_run;
+                            h++;
+                        }
+
+                        glm::ivec3 t_cellPos;
+                        t_cellPos[axis] = t_slice - 1;
+                        t_cellPos[u] = t_start;
+                        t_cellPos[v] = row;
+                        emitQuad(face, t_blockOrigin + t_cellPos, w, h, (MaterialID)(t_key & 0xFFFF), t_key >> 16,
+                                 origin, vertices, indices);
+                        stats.quads++;
+                    }
+                }
+            }
+        }
+    }
+    return stats;
+}
+
+MesherBenchmark benchmarkMeshers()
+{
+    static bool t_grid[VOXEL_COUNT][VOXEL_COUNT][VOXEL_COUNT];
+    int t_blockCount = (VOXEL_COUNT + BINARY_BLOCK_SIZE - 1) / BINARY_BLOCK_SIZE;
+    std::vector<BinaryBlock> t_blocks(t_blockCount * t_blockCount * t_blockCount);
+    memset(t_blocks.data(), 0, t_blocks.size() * sizeof(BinaryBlock));
+
+    MesherBenchmark result = {0, 0, 0, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+
+    // xorshift noise, roughly half of the cells are filled
+    uint32_t t_seed = 2463534242u;
+    for (int x = 0; x < VOXEL_COUNT; x++)
+        for (int y = 0; y < VOXEL_COUNT; y++)
+            for (int z = 0; z < VOXEL_COUNT; z++)
+            {
+                t_seed ^= t_seed << 13;
+                t_seed ^= t_seed >> 17;
+                t_seed ^= t_seed << 5;
+                t_grid[x][y][z] = t_seed & 1;
+                if (!t_grid[x][y][z])
+                    continue;
+                result.voxelCount++;
+                glm::ivec3 t_pos = glm::ivec3(x, y, z);
+                for (int dx = -1; dx <= 1; dx++)
+                    for (int dy = -1; dy <= 1; dy++)
+                        for (int dz = -1; dz <= 1; dz++)
+                        {
+                            glm::ivec3 t_block = glm::ivec3(floorDiv(x + dx, BINARY_BLOCK_SIZE), floorDiv(y + dy, BINARY_BLOCK_SIZE), floorDiv(z + dz, BINARY_BLOCK_SIZE));
+                            glm::ivec3 t_padded = t_pos - t_block * BINARY_BLOCK_SIZE + glm::ivec3(1);
+                            if (glm::any(glm::lessThan(t_block, glm::ivec3(0))) ||
+                                glm::any(glm::greaterThanEqual(t_block, glm::ivec3(t_blockCount))) ||
+                                glm::any(glm::lessThan(t_padded, glm::ivec3(0))) ||
+                                glm::any(glm::greaterThanEqual(t_padded, glm::ivec3(BINARY_PADDED_SIZE))))
+                                continue;
+                            setCell(t_blocks[(t_block.x * t_blockCount + t_block.y) * t_blockCount + t_block.z], t_padded);
+                        }
+            }
+
+    auto t_start = std::chrono::steady_clock::now();
+    for (int x = 0; x < VOXEL_COUNT; x++)
+        for (int y = 0; y < VOXEL_COUNT; y++)
+            for (int z = 0; z < VOXEL_COUNT; z++)
+            {
+                if (!t_grid[x][y][z])
+                    continue;
+                if (x + 1 >= VOXEL_COUNT || !t_grid[x + 1][y][z])
+                    result.scalarFaces++;
+                if (x - 1 < 0 || !t_grid[x - 1][y][z])
+                    result.scalarFaces++;
+                if (y + 1 >= VOXEL_COUNT || !t_grid[x][y + 1][z])
+                    result.scalarFaces++;
+                if (y - 1 < 0 || !t_grid[x][y - 1][z])
+                    result.scalarFaces++;
+                if (z + 1 >= VOXEL_COUNT || !t_grid[x][y][z + 1])
+                    result.scalarFaces++;
+                if (z - 1 < 0 || !t_grid[x][y][z - 1])
+                    result.scalarFaces++;
+            }
+    result.scalarTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+
+    t_start = std::chrono::steady_clock::now();
+    for (const BinaryBlock &block : t_blocks)
+        for (int axis = 0; axis < 3; axis++)
+            for (int j = 1; j <= BINARY_BLOCK_SIZE; j++)
+                for (int i = 1; i <= BINARY_BLOCK_SIZE; i++)
+                {
+                    uint64_t t_col = block.cols[axis][i + BINARY_PADDED_SIZE * j];
+                    result.binaryFaces += popCount(visibleFaces(t_col, axis * 2));
+                    result.binaryFaces += popCount(visibleFaces(t_col, axis * 2 + 1));
+                }
+    result.binaryTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+
+    // meshing cost of ambient occlusion, noise is the worst case since
+    // nearly every face is visible and few of them merge
+    ChunkMap t_occupancy;
+    std::vector<std::vector<Voxel>> t_chunks(8);
+    for (int x = 0; x < 2 * CHUNK_SIZE; x++)
+        for (int y = 0; y < 2 * CHUNK_SIZE; y++)
+            for (int z = 0; z < 2 * CHUNK_SIZE; z++)
+            {
+                if (!t_grid[x][y][z])
+                    continue;
+                Voxel t_voxel = {glm::i16vec3(x, y, z), 0};
+                t_chunks[(x / CHUNK_SIZE * 2 + y / CHUNK_SIZE) * 2 + z / CHUNK_SIZE].push_back(t_voxel);
+                t_occupancy.Set(glm::ivec3(x, y, z), true);
+            }
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    float *t_times[2][2] = {{&result.meshTime, &result.aoMeshTime},
+                            {&result.binaryMeshTime, &result.binaryAoMeshTime}};
+    for (int binary = 0; binary < 2; binary++)
+        for (int ambientOcclusion = 0; ambientOcclusion < 2; ambientOcclusion++)
+        {
+            t_start = std::chrono::steady_clock::now();
+            for (const std::vector<Voxel> &voxels : t_chunks)
+                buildMesh(voxels, t_occupancy, binary ? MeshMode::Binary : MeshMode::Greedy, ambientOcclusion != 0,
+                          vertices, indices);
+            *t_times[binary][ambientOcclusion] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+        }
+
+    return result;
+}
@@ -0,0 +1,72 @@
+#include "mesher.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+MeshStats buildLodMesh(const std::vector<Voxel> &voxels, int level, MeshMode mode,
+                       bool ambientOcclusion, std::vector<MeshVertex> &vertices,
+                       std::vector<uint32_t> &indices)
+{
+    auto t_start = std::chrono::steady_clock::now();
+    vertices.clear();
+    indices.clear();
+    MeshStats stats = {0, 0, 0.f};
+    if (voxels.empty())
+        return stats;
+
+    // (coarse cell, material) of every voxel, sorted so each cell's
+    // materials are next to each other
+    int t_scale = 1 << level;
+    int t_cells = CHUNK_SIZE / t_scale;
+    glm::ivec3 t_chunk = ChunkMap::ChunkCoord(glm::ivec3(voxels.front().pos));
+    std::vector<std::pair<uint32_t, MaterialID>> t_samples;
+    t_samples.reserve(voxels.size());
+    for (const Voxel &voxel : voxels)
+    {
+        glm::ivec3 t_cell = ChunkMap::LocalCoord(glm::ivec3(voxel.pos)) / t_scale;
+        t_samples.push_back(std::make_pair((uint32_t)((t_cell.x * t_cells + t_cell.y) * t_cells + t_cell.z), voxel.mat));
+    }
+    std::sort(t_samples.begin(), t_samples.end());
+
+    // a cell is solid when any voxel in it is, so coarse geometry always
+    // covers the full detail surface, and takes the most common material
+    std::vector<Voxel> t_coarse;
+    ChunkMap t_occupancy;
+    glm::ivec3 t_origin = t_chunk * (CHUNK_SIZE / t_scale);
+    for (size_t i = 0; i < t_samples.size();)
+    {
+        uint32_t t_cell = t_samples[i].first;
+        MaterialID t_best = t_samples[i].second;
+        size_t t_bestCount = 0;
+        while (i < t_samples.size() && t_samples[i].first == t_cell)
+        {
+            size_t j = i;
+            while (j < t_samples.size() && t_samples[j] == t_samples[i])
+                j++;
+            if (j - i > t_bestCount)
+            {
+                t_bestCount = j - i;
+                t_best = t_samples[i].second;
+            }
+            i = j;
+        }
+        glm::ivec3 t_pos = t_origin + glm::ivec3(t_cell / (t_cells * t_cells), (t_cell / t_cells) % t_cells, t_cell % t_cells);
+        t_coarse.push_back({glm::i16vec3(t_pos), t_best});
+        t_occupancy.Set(t_pos, true);
+    }
+
+    // neighbour chunks are left out of the occupancy so faces on the chunk
+    // border are always emitted, closing cracks towards chunks of other levels
+    // coarse corners are relative to the coarse chunk holding t_origin,
+    // scaled up they are relative to the full detail chunk again
+    stats = buildMesh(t_coarse, t_occupancy, mode, ambientOcclusion, vertices, indices);
+    glm::ivec3 t_coarseOrigin = ChunkMap::ChunkCoord(t_origin) * CHUNK_SIZE;
+    for (MeshVertex &vertex : vertices)
+    {
+        UnpackedVertex t_vertex = unpackVertex(vertex);
+        glm::ivec3 t_corner = (t_coarseOrigin + t_vertex.corner) * t_scale - t_chunk * CHUNK_SIZE;
+        vertex = packVertex(t_corner, t_vertex.face, t_vertex.ao, t_vertex.material);
+    }
+    stats.buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    return stats;
+}
@@ -0,0 +1,270 @@
+#include "mesher.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+// faces ordered right, left, top, bot, front, back
+static const glm::ivec3 FACE_NORMALS[6] = {
+    {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+
+AoSampler::AoSampler(const ChunkMap &occupancy) : m_occupancy(occupancy)
+{
+    m_key = glm::ivec3(std::numeric_limits<int>::max());
+    m_chunk = nullptr;
+}
+
+bool AoSampler::solid(glm::ivec3 pos)
+{
+    glm::ivec3 t_key = ChunkMap::ChunkCoord(pos);
+    if (t_key != m_key)
+    {
+        m_key = t_key;
+        m_chunk = m_occupancy.GetChunk(t_key);
+    }
+    if (!m_chunk)
+        return false;
+    glm::ivec3 t_local = ChunkMap::LocalCoord(pos);
+    return (m_chunk->columns[t_local.x][t_local.y] >> t_local.z) & 1u;
+}
+
+uint32_t AoSampler::FaceAO(int face, glm::ivec3 cell)
+{
+    int axis = face / 2;
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+    glm::ivec3 t_front = cell + FACE_NORMALS[face];
+
+    // the eight cells around the one in front of the face, read straight
+    // from the columns when none of them crosses into another chunk
+    bool t_solid[3][3];
+    glm::ivec3 t_local = ChunkMap::LocalCoord(t_front);
+    bool t_inside = t_local[u] > 0 && t_local[u] < CHUNK_SIZE - 1 &&
+                    t_local[v] > 0 && t_local[v] < CHUNK_SIZE - 1;
+    if (t_inside)
+        solid(t_front);
+    for (int j = -1; j <= 1; j++)
+        for (int i = -1; i <= 1; i++)
+        {
+            if (i == 0 && j == 0)
+                continue;
+            glm::ivec3 t_pos = t_inside ? t_local : t_front;
+            t_pos[u] += i;
+            t_pos[v] += j;
+            if (!t_inside)
+                t_solid[i + 1][j + 1] = solid(t_pos);
+            else
+                t_solid[i + 1][j + 1] = m_chunk && ((m_chunk->columns[t_pos.x][t_pos.y] >> t_pos.z) & 1u);
+        }
+
+    const int corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+    uint32_t result = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int du = corners[i][0];
+        int dv = corners[i][1];
+        bool t_side1 = t_solid[du + 1][1];
+        bool t_side2 = t_solid[1][dv + 1];
+        bool t_corner = t_solid[du + 1][dv + 1];
+        // two sides hide the corner cell completely
+        int t_ao = (t_side1 && t_side2) ? 0 : VERTEX_AO_MAX - (t_side1 + t_side2 + t_corner);
+        result |= (uint32_t)t_ao << (i * 2);
+    }
+    return result;
+}
+
+// Emits a w x h rectangle of the given face, cell is the voxel in its
+// lowest u/v corner
+void emitQuad(int face, glm::ivec3 cell, int w, int h, MaterialID mat, uint32_t ao,
+              glm::ivec3 origin, std::vector<MeshVertex> &vertices,
+              std::vector<uint32_t> &indices)
+{
+    int axis = face / 2;
+    int u = (axis + 1) % 3;
+    int v = (axis + 2) % 3;
+
+    // corners counter clockwise when looking against the normal
+    const int corners[4][2] = {{0, 0}, {w, 0}, {w, h}, {0, h}};
+
+    // voxel corners, cell i spans corners i and i + 1
+    glm::ivec3 start = cell - origin + glm::max(FACE_NORMALS[face], glm::ivec3(0));
+
+    uint32_t first = (uint32_t)vertices.size();
+    int t_ao[4];
+    for (int i = 0; i < 4; i++)
+    {
+        int corner = (face % 2 == 0) ? i : 3 - i;
+        glm::ivec3 t_corner = start;
+        t_corner[u] += corners[corner][0];
+        t_corner[v] += corners[corner][1];
+        t_ao[i] = (ao >> (corner * 2)) & VERTEX_AO_MAX;
+        vertices.push_back(packVertex(t_corner, face, t_ao[i], mat));
+    }
+    // split along the brighter diagonal, otherwise a single dark corner
+    // bleeds across the whole quad and the shading depends on the rotation
+    uint32_t t_offset = (t_ao[1] + t_ao[3] > t_ao[0] + t_ao[2]) ? 1 : 0;
+    indices.push_back(first + t_offset);
+    indices.push_back(first + t_offset + 1);
+    indices.push_back(first + (t_offset + 2) % 4);
+    indices.push_back(first + (t_offset + 2) % 4);
+    indices.push_back(first + (t_offset + 3) % 4);
+    indices.push_back(first + t_offset);
+}
+
+static MeshStats buildGreedyMesh(const std::vector<Voxel> &voxels,
+                                 const ChunkMap &occupancy, glm::ivec3 origin,
+                                 bool ambientOcclusion, std::vector<MeshVertex> &vertices,
+                                 std::vector<uint32_t> &indices)
+{
+    MeshStats stats = {0, 0, 0.f};
+    if (voxels.empty())
+        return stats;
+
+    // material of every cell inside the bounding box plus one, 0 is empty
+    glm::ivec3 min = glm::ivec3(voxels.front().pos);
+    glm::ivec3 max = min;
+    for (const Voxel &voxel : voxels)
+    {
+        min = glm::min(min, glm::ivec3(voxel.pos));
+        max = glm::max(max, glm::ivec3(voxel.pos));
+    }
+    glm::ivec3 size = max - min + glm::ivec3(1);
+    std::vector<uint32_t> cells((size_t)size.x * size.y * size.z, 0);
+    for (const Voxel &voxel : voxels)
+    {
+        glm::ivec3 t_pos = glm::ivec3(voxel.pos) - min;
+        cells[((size_t)t_pos.x * size.y + t_pos.y) * size.z + t_pos.z] = voxel.mat + 1;
+    }
+    // neighbours outside of the bounding box are looked up in occupancy
+    auto cellAt = [&](glm::ivec3 t_pos) -> uint32_t
+    {
+        if (t_pos.x < 0 || t_pos.x >= size.x ||
+            t_pos.y < 0 || t_pos.y >= size.y ||
+            t_pos.z < 0 || t_pos.z >= size.z)
+            return occupancy.Get(t_pos + min) ? 1 : 0;
+        return cells[((size_t)t_pos.x * size.y + t_pos.y) * size.z + t_pos.z];
+    };
+
+    // mask entries are material + 1 with the corner AO in the top byte, so
+    // only faces that shade the same way are merged
+    AoSampler t_sampler(occupancy);
+    std::vector<uint32_t> mask;
+    for (int face = 0; face < 6; face++)
+    {
+        int axis = face / 2;
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        mask.assign((size_t)size[u] * size[v], 0);
+
+        for (int slice = 0; slice < size[axis]; slice++)
+        {
+            // faces of this slice that are not covered by a neighbour
+            glm::ivec3 t_pos;
+            t_pos[axis] = slice;
+            for (int j = 0; j < size[v]; j++)
+            {
+                t_pos[v] = j;
+                for (int i = 0; i < size[u]; i++)
+                {
+                    t_pos[u] = i;
+                    uint32_t t_cell = cells[((size_t)t_pos.x * size.y + t_pos.y) * size.z + t_pos.z];
+                    if (t_cell && cellAt(t_pos + FACE_NORMALS[face]))
+                        t_cell = 0;
+                    if (t_cell)
+                    {
+                        stats.visibleFaces++;
+                        uint32_t t_ao = ambientOcclusion ? t_sampler.FaceAO(face, t_pos + min) : AO_NONE;
+                        t_cell |= t_ao << 24;
+                    }
+                    mask[(size_t)j * size[u] + i] = t_cell;
+                }
+            }
+
+            // grow each face first along u, then along v
+            for (int j = 0; j < size[v]; j++)
+            {
+                for (int i = 0; i < size[u];)
+                {
+                    uint32_t t_cell = mask[(size_t)j * size[u] + i];
+                    if (!t_cell)
+                    {
+                        i++;
+                        continue;
+                    }
+                    int w = 1;
+                    while (i + w < size[u] && mask[(size_t)j * size[u] + i + w] == t_cell)
+                        w++;
+                    int h = 1;
+                    while (j + h < size[v])
+                    {
+                        const uint32_t *row = &mask[(size_t)(j + h) * size[u] + i];
+                        if (std::any_of(row, row + w, [t_cell](uint32_t c)
+                                        { return c != t_cell; }))
+                            break;
+                        h++;
+                    }
+                    for (int k = 0; k < h; k++)
+                        std::fill_n(&mask[(size_t)(j + k) * size[u] + i], w, 0);
+
+                    glm::ivec3 t_cellPos;
+                    t_cellPos[axis] = slice;
+                    t_cellPos[u] = i;
+                    t_cellPos[v] = j;
+                    emitQuad(face, t_cellPos + min, w, h, (MaterialID)((t_cell & 0xFFFFFF) - 1), t_cell >> 24,
+                             origin, vertices, indices);
+                    stats.quads++;
+                    i += w;
+                }
+            }
+        }
+    }
+    return stats;
+}
+
+static MeshStats buildCulledMesh(const std::vector<Voxel> &voxels,
+                                 const ChunkMap &occupancy,
+                                 glm::ivec3 origin, bool cullHidden, bool ambientOcclusion,
+                                 std::vector<MeshVertex> &vertices,
+                                 std::vector<uint32_t> &indices)
+{
+    MeshStats stats = {0, 0, 0.f};
+    AoSampler t_sampler(occupancy);
+    for (const Voxel &voxel : voxels)
+    {
+        glm::ivec3 t_pos = glm::ivec3(voxel.pos);
+        for (int face = 0; face < 6; face++)
+        {
+            bool t_hidden = occupancy.Get(t_pos + FACE_NORMALS[face]);
+            if (!t_hidden)
+                stats.visibleFaces++;
+            if (t_hidden && cullHidden)
+                continue;
+            uint32_t t_ao = ambientOcclusion ? t_sampler.FaceAO(face, t_pos) : AO_NONE;
+            emitQuad(face, t_pos, 1, 1, voxel.mat, t_ao, origin, vertices, indices);
+            stats.quads++;
+        }
+    }
+    return stats;
+}
+
+MeshStats buildMesh(const std::vector<Voxel> &voxels, const ChunkMap &occupancy,
+                    MeshMode mode, bool ambientOcclusion, std::vector<MeshVertex> &vertices,
+                    std::vector<uint32_t> &indices)
+{
+    auto t_start = std::chrono::steady_clock::now();
+    vertices.clear();
+    indices.clear();
+    MeshStats stats = {0, 0, 0.f};
+    if (voxels.empty())
+        return stats;
+
+    glm::ivec3 origin = ChunkMap::ChunkCoord(glm::ivec3(voxels.front().pos)) * CHUNK_SIZE;
+    if (mode == MeshMode::Greedy)
+        stats = buildGreedyMesh(voxels, occupancy, origin, ambientOcclusion, vertices, indices);
+    else if (mode == MeshMode::Binary)
+        stats = buildBinaryMesh(voxels, occupancy, origin, ambientOcclusion, vertices, indices);
+    else
+        stats = buildCulledMesh(voxels, occupancy, origin, mode == MeshMode::Culled, ambientOcclusion, vertices, indices);
+    stats.buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    return stats;
+}
@@ -0,0 +1,92 @@
+#include "../items/items.hpp"
+#include "../chunk/chunk.hpp"
+#include "vertex_layout.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#ifndef MESHER_HPP
+#define MESHER_HPP
+
+enum class MeshMode
+{
+  Naive,  // every face of every voxel
+  Culled, // only faces without a neighbour
+  Greedy, // culled faces merged into maximal same-material rectangles
+  Binary  // same result as Greedy, built from 64-bit column masks
+};
+
+struct MeshStats
+{
+  uint32_t visibleFaces; // faces without a neighbour, before any merging
+  uint32_t quads;        // quads actually written to the buffers
+  float buildTime;       // ms
+};
+
+struct MesherBenchmark
+{
+  uint32_t voxelCount;
+  uint32_t scalarFaces;
+  uint32_t binaryFaces;
+  float scalarTime; // ms
+  float binaryTime; // ms
+  float meshTime;         // ms, greedy meshing of the first 2x2x2 chunks
+  float aoMeshTime;       // ms, the same with ambient occlusion
+  float binaryMeshTime;   // ms, the same chunks with the binary mesher
+  float binaryAoMeshTime; // ms, binary mesher with ambient occlusion
+};
+
+// Corner ambient occlusion of voxel faces, each corner is darkened by the
+// two cells next to it and the one diagonal to it in the layer in front of
+// the face. The last chunk is remembered since nearly every lookup stays in it.
+class AoSampler
+{
+public:
+  AoSampler(const ChunkMap &occupancy);
+  // four corners in emitQuad order, two bits each
+  uint32_t FaceAO(int face, glm::ivec3 cell);
+
+private:
+  bool solid(glm::ivec3 pos);
+
+  const ChunkMap &m_occupancy;
+  glm::ivec3 m_key;
+  const Chunk *m_chunk;
+};
+
+// every corner fully lit
+#define AO_NONE 0xFFu
+
+// Builds one vertex/index buffer for the voxels of one chunk, vertex
+// positions are relative to that chunk's origin. Neighbours that are not in
+// the list are looked up in occupancy.
+MeshStats buildMesh(const std::vector<Voxel> &voxels, const ChunkMap &occupancy,
+                    MeshMode mode, bool ambientOcclusion, std::vector<MeshVertex> &vertices,
+                    std::vector<uint32_t> &indices);
+
+MeshStats buildBinaryMesh(const std::vector<Voxel> &voxels, const ChunkMap &occupancy,
+                          glm::ivec3 origin, bool ambientOcclusion,
+                          std::vector<MeshVertex> &vertices, std::vector<uint32_t> &indices);
+
+// Mesh of a single chunk downsampled level times by 2x2x2, vertices are in
+// full detail coordinates
+MeshStats buildLodMesh(const std::vector<Voxel> &voxels, int level, MeshMode mode,
+                       bool ambientOcclusion, std::vector<MeshVertex> &vertices,
+                       std::vector<uint32_t> &indices);
+
+// Counts visible faces of a half filled VOXEL_COUNT^3 grid once with the
+// scalar neighbour test and once with column masks
+MesherBenchmark benchmarkMeshers();
+
+// Meshes the chunks of a hollow sphere on 1 to maxThreads job system
+// threads, returns chunks per second for every thread count
+std::vector<float> benchmarkChunkMeshing(unsigned maxThreads);
+
+// shared by both mesher backends, origin is the first cell of the chunk and
+// ao comes from AoSampler::FaceAO or the binary mesher's column masks
+void emitQuad(int face, glm::ivec3 cell, int w, int h, MaterialID mat, uint32_t ao,
+              glm::ivec3 origin, std::vector<MeshVertex> &vertices,
+              std::vector<uint32_t> &indices);
+
+#endif
@@ -0,0 +1,58 @@
+#include "mesher.hpp"
+#include "../job_system/job_system.hpp"
+
+#include <chrono>
+#include <map>
+#include <tuple>
+
+#define BENCHMARK_SPHERE_RADIUS 100
+#define BENCHMARK_SPHERE_THICKNESS 2
+
+std::vector<float> benchmarkChunkMeshing(unsigned maxThreads)
+{
+    ChunkMap t_occupancy;
+    std::map<std::tuple<int, int, int>, std::vector<Voxel>> t_chunks;
+
+    int r = BENCHMARK_SPHERE_RADIUS;
+    for (int x = -r; x <= r; x++)
+        for (int y = -r; y <= r; y++)
+            for (int z = -r; z <= r; z++)
+            {
+                int t_dist = x * x + y * y + z * z;
+                int t_inner = r - BENCHMARK_SPHERE_THICKNESS;
+                if (t_dist > r * r || t_dist < t_inner * t_inner)
+                    continue;
+                glm::ivec3 t_pos = glm::ivec3(x, y, z);
+                glm::ivec3 t_key = ChunkMap::ChunkCoord(t_pos);
+                Voxel t_voxel;
+                t_voxel.pos = t_pos;
+                t_voxel.mat = 0;
+                t_chunks[std::make_tuple(t_key.x, t_key.y, t_key.z)].push_back(t_voxel);
+                t_occupancy.Set(t_pos, true);
+            }
+
+    std::vector<std::vector<MeshVertex>> t_vertices(t_chunks.size());
+    std::vector<std::vector<uint32_t>> t_indices(t_chunks.size());
+    std::vector<float> result;
+    for (unsigned threads = 1; threads <= maxThreads; threads++)
+    {
+        JobSystem t_jobSystem(threads);
+        auto t_start = std::chrono::steady_clock::now();
+        size_t i = 0;
+        for (auto &entry : t_chunks)
+        {
+            const std::vector<Voxel> *t_voxels = &entry.second;
+            std::vector<MeshVertex> *vertices = &t_vertices[i];
+            std::vector<uint32_t> *indices = &t_indices[i];
+            t_jobSystem.Submit([&t_occupancy, t_voxels, vertices, indices]()
+            {
+                buildMesh(*t_voxels, t_occupancy, MeshMode::Greedy, false, *vertices, *indices);
+            });
+            i++;
+        }
+        t_jobSystem.Wait();
+        float t_seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - t_start).count();
+        result.push_back(t_chunks.size() / t_seconds);
+    }
+    return result;
+}
@@ -0,0 +1,44 @@
+#include "vertex_layout.hpp"
+
+#include <sstream>
+
+#define VERTEX_MASK(bits) ((1u << (bits)) - 1)
+
+MeshVertex packVertex(glm::ivec3 corner, int face, int ao, MaterialID material)
+{
+    MeshVertex t_vertex;
+    t_vertex.packed = ((uint32_t)corner.x & VERTEX_MASK(VERTEX_POSITION_BITS)) << VERTEX_X_SHIFT |
+                      ((uint32_t)corner.y & VERTEX_MASK(VERTEX_POSITION_BITS)) << VERTEX_Y_SHIFT |
+                      ((uint32_t)corner.z & VERTEX_MASK(VERTEX_POSITION_BITS)) << VERTEX_Z_SHIFT |
+                      ((uint32_t)face & VERTEX_MASK(VERTEX_FACE_BITS)) << VERTEX_FACE_SHIFT |
+                      ((uint32_t)ao & VERTEX_MASK(VERTEX_AO_BITS)) << VERTEX_AO_SHIFT;
+    t_vertex.material = material;
+    return t_vertex;
+}
+
+UnpackedVertex unpackVertex(const MeshVertex &vertex)
+{
+    UnpackedVertex t_vertex;
+    t_vertex.corner.x = (int)((vertex.packed >> VERTEX_X_SHIFT) & VERTEX_MASK(VERTEX_POSITION_BITS));
+    t_vertex.corner.y = (int)((vertex.packed >> VERTEX_Y_SHIFT) & VERTEX_MASK(VERTEX_POSITION_BITS));
+    t_vertex.corner.z = (int)((vertex.packed >> VERTEX_Z_SHIFT) & VERTEX_MASK(VERTEX_POSITION_BITS));
+    t_vertex.face = (int)((vertex.packed >> VERTEX_FACE_SHIFT) & VERTEX_MASK(VERTEX_FACE_BITS));
+    t_vertex.ao = (int)((vertex.packed >> VERTEX_AO_SHIFT) & VERTEX_MASK(VERTEX_AO_BITS));
+    t_vertex.material = (MaterialID)vertex.material;
+    return t_vertex;
+}
+
+std::string getVertexLayoutDefines()
+{
+    std::stringstream t_defines;
+    t_defines << "#define VERTEX_POSITION_BITS " << VERTEX_POSITION_BITS << "\n"
+              << "#define VERTEX_X_SHIFT " << VERTEX_X_SHIFT << "\n"
+              << "#define VERTEX_Y_SHIFT " << VERTEX_Y_SHIFT << "\n"
+              << "#define VERTEX_Z_SHIFT " << VERTEX_Z_SHIFT << "\n"
+              << "#define VERTEX_FACE_SHIFT " << VERTEX_FACE_SHIFT << "\n"
+              << "#define VERTEX_FACE_BITS " << VERTEX_FACE_BITS << "\n"
+              << "#define VERTEX_AO_SHIFT " << VERTEX_AO_SHIFT << "\n"
+              << "#define VERTEX_AO_BITS " << VERTEX_AO_BITS << "\n"
+              << "#define VERTEX_AO_MAX " << VERTEX_AO_MAX << "\n";
+    return t_defines.str();
+}
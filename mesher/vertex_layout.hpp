@@ -0,0 +1,47 @@
+#include "../items/items.hpp"
+#include "../chunk/chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+
+#ifndef VERTEX_LAYOUT_HPP
+#define VERTEX_LAYOUT_HPP
+
+// Bit layout of MeshVertex::packed, basic.vert gets the same numbers as
+// #defines from getVertexLayoutDefines so both sides always agree.
+// Positions are voxel corners relative to the chunk origin, 0..CHUNK_SIZE
+#define VERTEX_POSITION_BITS 6
+#define VERTEX_X_SHIFT 0
+#define VERTEX_Y_SHIFT 6
+#define VERTEX_Z_SHIFT 12
+#define VERTEX_FACE_SHIFT 18 // right, left, top, bot, front, back
+#define VERTEX_FACE_BITS 3
+#define VERTEX_AO_SHIFT 21 // 0 fully occluded .. 3 fully lit
+#define VERTEX_AO_BITS 2
+#define VERTEX_AO_MAX 3
+
+// Vertex of a CPU-built voxel mesh, 8 bytes, material is an index into
+// the palette texture
+struct MeshVertex
+{
+  uint32_t packed;
+  uint32_t material;
+};
+
+struct UnpackedVertex
+{
+  glm::ivec3 corner; // relative to the chunk origin
+  int face;
+  int ao;
+  MaterialID material;
+};
+
+MeshVertex packVertex(glm::ivec3 corner, int face, int ao, MaterialID material);
+
+UnpackedVertex unpackVertex(const MeshVertex &vertex);
+
+// GLSL #define lines of the layout above, inserted after #version
+std::string getVertexLayoutDefines();
+
+#endif
@@ -1,114 +1,668 @@
 #include "object.hpp"
 
-Object::Object()
+static BasicUniforms getBasicUniforms(const Shader &shader)
+{
+    BasicUniforms t_uniforms;
+    t_uniforms.viewPos = shader.GetUniform("viewPos");
+    t_uniforms.lightDirection = shader.GetUniform("light.direction");
+    t_uniforms.lightAmbient = shader.GetUniform("light.ambient");
+    t_uniforms.lightDiffuse = shader.GetUniform("light.diffuse");
+    t_uniforms.lightSpecular = shader.GetUniform("light.specular");
+    t_uniforms.projection = shader.GetUniform("projection");
+    t_uniforms.view = shader.GetUniform("view");
+    t_uniforms.model = shader.GetUniform("model");
+    return t_uniforms;
+}
+
+Object::Object(JobSystem *jobSystem)
 {
     name = "new_object";
-    memset(m_hashVoxels, 0, sizeof(m_hashVoxels));
-    loadVertexBuffer(m_vertices);
-    loadIndexBuffer(m_indices);
+    m_jobSystem = jobSystem;
+    m_meshMode = MeshMode::Culled;
+    m_ambientOcclusion = false;
+    m_meshStats = {0, 0, 0.f};
+    m_remeshStats = {0, 0.f};
+    m_pagingStats = {0, 0, 0, 0, 0, 0.f, 0.f};
+    m_frame = 0;
+    m_cullStats = {0, 0, 0, 0};
+    m_occlusionCulling = false;
+    m_lodStats = {};
+    m_region.Open(std::string(FILES_PATH) + "paging" + REGION_FILE_EXTENSION);
+
+    glEnable(GL_DEPTH_TEST);
+
+    m_shader.Init("basic", "basic", getVertexLayoutDefines());
+    m_uniforms = getBasicUniforms(m_shader);
+    m_chunkOriginUniform = m_shader.GetUniform("chunkOrigin");
+    m_meshMaterialsUniform = m_shader.GetUniform("materials");
+    initInstancing();
+    m_volume.Init();
+    m_volumeDirty = true;
+    AddVoxel(glm::ivec3(0, 0, 0), registerMaterial(loadMaterial("ruby")));
+}
+
+void Object::Draw(MVP mvp, glm::vec3 cameraPosition, Light light, RenderMode renderMode)
+{
+    if (m_paletteVersion != getMaterialPaletteVersion())
+        updatePalette();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, m_paletteTexture);
+
+    if (renderMode == RenderMode::Instanced)
+    {
+        if (m_instancesDirty)
+            updateInstances();
+        useShader(m_instancedShader, m_instancedUniforms, mvp, cameraPosition, light);
+        m_instancedShader.SetInt(m_materialsUniform, 0);
+        glBindVertexArray(m_cubeVAO);
+        glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)m_cubeIndexCount, GL_UNSIGNED_INT, (void *)0, (GLsizei)m_instanceCount);
+        glBindVertexArray(0);
+        return;
+    }
+
+    if (renderMode == RenderMode::RayMarch)
+    {
+        updateVolume();
+        if (!m_volume.GetStats().tooLarge)
+        {
+            m_volume.Draw(mvp, cameraPosition, light, m_paletteTexture);
+            return;
+        }
+        // no 3D texture fits the object, the chunk meshes draw it instead
+    }
+
+    // chunk bounds are in object space, so the frustum includes the model matrix
+    m_chunkBoxes.Clear();
+    m_drawChunks.clear();
+    m_drawLevels.clear();
+    m_drawOrigins.clear();
+    for (auto &entry : m_chunks)
+    {
+        // the wanted level, or the closest one already built
+        int t_level = -1;
+        for (int offset = 0; offset < LOD_LEVELS && t_level < 0; offset++)
+        {
+            int t_finer = (int)entry.second.lod - offset;
+            int t_coarser = (int)entry.second.lod + offset;
+            if (t_finer >= 0 && entry.second.lods[t_finer].built)
+                t_level = t_finer;
+            else if (t_coarser < LOD_LEVELS && entry.second.lods[t_coarser].built)
+                t_level = t_coarser;
+        }
+        if (t_level < 0 || !entry.second.lods[t_level].indexCount)
+            continue;
+        glm::vec3 t_min = glm::vec3(entry.first * CHUNK_SIZE) - glm::vec3(0.5f);
+        m_chunkBoxes.Add(t_min, t_min + glm::vec3(CHUNK_SIZE));
+        m_drawChunks.push_back(&entry.second);
+        m_drawLevels.push_back((uint32_t)t_level);
+        m_drawOrigins.push_back(entry.first * CHUNK_SIZE);
+    }
+    glm::mat4 t_mvp = mvp.projection * mvp.view * mvp.model;
+    cullBoxes(extractFrustum(t_mvp), m_chunkBoxes, m_chunkVisible);
+    m_cullStats = {0, 0, 0, 0};
+    for (size_t i = 0; i < m_drawChunks.size(); i++)
+        if (!m_chunkVisible[i])
+            m_cullStats.culledChunks++;
+
+    if (m_occlusionCulling)
+    {
+        // nearest occluders of the chunks in the frustum
+        glm::vec3 t_eye = glm::vec3(glm::inverse(mvp.model) * glm::vec4(cameraPosition, 1.f));
+        m_occluders.clear();
+        for (size_t i = 0; i < m_drawChunks.size(); i++)
+            if (m_chunkVisible[i])
+                m_occluders.insert(m_occluders.end(), m_drawChunks[i]->occluders.begin(), m_drawChunks[i]->occluders.end());
+        if (m_occluders.size() > MAX_OCCLUDERS)
+        {
+            std::nth_element(m_occluders.begin(), m_occluders.begin() + MAX_OCCLUDERS, m_occluders.end(),
+                             [t_eye](const Box &a, const Box &b)
+                             { return glm::distance((a.min + a.max) * 0.5f, t_eye) < glm::distance((b.min + b.max) * 0.5f, t_eye); });
+            m_occluders.resize(MAX_OCCLUDERS);
+        }
+
+        m_occlusion.Clear(t_mvp);
+        for (const Box &occluder : m_occluders)
+            m_occlusion.AddOccluder(occluder.min, occluder.max);
+        m_occlusion.BuildPyramid();
+        m_cullStats.occluders = m_occlusion.GetOccluderCount();
+
+        for (size_t i = 0; i < m_drawChunks.size(); i++)
+        {
+            if (!m_chunkVisible[i])
+                continue;
+            glm::vec3 t_center = glm::vec3(m_chunkBoxes.centerX[i], m_chunkBoxes.centerY[i], m_chunkBoxes.centerZ[i]);
+            glm::vec3 t_extent = glm::vec3(m_chunkBoxes.extentX[i], m_chunkBoxes.extentY[i], m_chunkBoxes.extentZ[i]);
+            if (!m_occlusion.IsVisible(t_center - t_extent, t_center + t_extent))
+            {
+                m_chunkVisible[i] = 0;
+                m_cullStats.occludedChunks++;
+            }
+        }
+    }
 
-    glGenVertexArrays(1, &m_VAO);
-    glBindVertexArray(m_VAO);
+    useShader(m_shader, m_uniforms, mvp, cameraPosition, light);
+    m_shader.SetInt(m_meshMaterialsUniform, 0);
+    m_lodStats = {};
+    for (size_t i = 0; i < m_drawChunks.size(); i++)
+    {
+        if (!m_chunkVisible[i])
+            continue;
+        const LodMesh &mesh = m_drawChunks[i]->lods[m_drawLevels[i]];
+        m_cullStats.drawnChunks++;
+        m_lodStats.chunks[m_drawLevels[i]]++;
+        m_lodStats.triangles[m_drawLevels[i]] += mesh.indexCount / 3;
+        m_shader.SetIVec3(m_chunkOriginUniform, m_drawOrigins[i]);
+        glBindVertexArray(mesh.VAO);
+        glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indexCount, GL_UNSIGNED_INT, (void *)0);
+    }
+    glBindVertexArray(0);
+    return;
+}
+
+void Object::useShader(Shader &shader, const BasicUniforms &uniforms, MVP mvp,
+                       glm::vec3 cameraPosition, Light light)
+{
+    shader.Use();
+
+    shader.SetVec3(uniforms.viewPos, cameraPosition);
 
-    glGenBuffers(1, &m_VBO);
-    glGenBuffers(1, &m_EBO);
+    shader.SetVec3(uniforms.lightDirection, light.direction);
+    shader.SetVec3(uniforms.lightAmbient, light.ambient);
+    shader.SetVec3(uniforms.lightDiffuse, light.diffuse);
+    shader.SetVec3(uniforms.lightSpecular, light.specular);
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex),
-                 &m_vertices.front(), GL_STATIC_DRAW);
+    shader.SetMat4(uniforms.projection, mvp.projection);
+    shader.SetMat4(uniforms.view, mvp.view);
+    shader.SetMat4(uniforms.model, mvp.model);
+}
+
+// Uploads the cube from vert_buffer.txt/ind_buffer.txt once, instances
+// read their position and material ID straight from the Voxel structs
+void Object::initInstancing()
+{
+    std::vector<Vertex> t_vertices;
+    std::vector<uint32_t> t_indices;
+    loadVertexBuffer(t_vertices);
+    loadIndexBuffer(t_indices);
+    m_cubeIndexCount = (uint32_t)t_indices.size();
+    m_instanceCount = 0;
+    m_instancesDirty = true;
+
+    glGenVertexArrays(1, &m_cubeVAO);
+    glBindVertexArray(m_cubeVAO);
+
+    glGenBuffers(1, &m_cubeVBO);
+    glGenBuffers(1, &m_cubeEBO);
+    glGenBuffers(1, &m_instanceVBO);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t),
-                 &m_indices.front(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, m_cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, t_vertices.size() * sizeof(Vertex),
+                 t_vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_cubeEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, t_indices.size() * sizeof(uint32_t),
+                 t_indices.data(), GL_STATIC_DRAW);
 
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, pos));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-                          (void *)sizeof(glm::vec3));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, normals));
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glEnableVertexAttribArray(2);
+    glVertexAttribIPointer(2, 3, GL_SHORT, sizeof(Voxel), (void *)offsetof(Voxel, pos));
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 1, GL_UNSIGNED_SHORT, sizeof(Voxel), (void *)offsetof(Voxel, mat));
+    glVertexAttribDivisor(3, 1);
     glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    glEnable(GL_DEPTH_TEST);
+    glGenBuffers(1, &m_paletteTBO);
+    glGenTextures(1, &m_paletteTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_paletteTBO);
+    glBindTexture(GL_TEXTURE_BUFFER, m_paletteTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_paletteTBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    updatePalette();
 
-    m_shader.Init("basic", "basic");
-    AddVoxel(glm::ivec3(0, 0, 0), loadMaterial("ruby"));
+    m_instancedShader.Init("instanced", "basic");
+    m_instancedUniforms = getBasicUniforms(m_instancedShader);
+    m_materialsUniform = m_instancedShader.GetUniform("materials");
 }
 
-void Object::Draw(MVP mvp, glm::vec3 cameraPosition, Light light, bool optimizedMode)
+void Object::updateInstances()
 {
-    m_shader.Use();
+    std::vector<Voxel> t_voxels = GetListOfVoxels();
+    m_instanceCount = (uint32_t)t_voxels.size();
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, t_voxels.size() * sizeof(Voxel),
+                 t_voxels.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_instancesDirty = false;
+}
 
-    m_shader.SetVec3("viewPos", cameraPosition);
+void Object::updatePalette()
+{
+    std::vector<glm::vec4> t_palette = packMaterialPalette(getMaterialPalette());
+    glBindBuffer(GL_TEXTURE_BUFFER, m_paletteTBO);
+    glBufferData(GL_TEXTURE_BUFFER, t_palette.size() * sizeof(glm::vec4),
+                 t_palette.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    m_paletteVersion = getMaterialPaletteVersion();
+}
+
+// Rewrites the boxes of the chunks edited since the last frame, falling
+// back to a full upload when an edit lies outside the uploaded volume
+void Object::updateVolume()
+{
+    std::vector<Voxel> t_voxels;
+    for (auto it = m_volumeChunks.begin(); it != m_volumeChunks.end() && !m_volumeDirty; ++it)
+    {
+        t_voxels.clear();
+        auto t_chunk = m_chunks.find(*it);
+        if (t_chunk != m_chunks.end() && t_chunk->second.state != ChunkState::Resident)
+            m_region.Read(*it, t_voxels);
+        else if (t_chunk != m_chunks.end())
+        {
+            unpackChunk(*it, t_chunk->second);
+            t_voxels = t_chunk->second.voxels;
+        }
+        if (!m_volume.UploadBox(*it * CHUNK_SIZE, glm::ivec3(CHUNK_SIZE), t_voxels))
+            m_volumeDirty = true;
+    }
+    m_volumeChunks.clear();
+    if (m_volumeDirty)
+        m_volume.Upload(GetListOfVoxels());
+    m_volumeDirty = false;
+}
+
+// Pages in evicted chunks near the camera and evicts the least recently
+// used far chunks once more than MAX_RESIDENT_CHUNKS are resident
+void Object::UpdateResidency(glm::vec3 cameraPosition)
+{
+    m_frame++;
+
+    std::vector<std::unique_ptr<PageJob>> t_pagedIn;
+    {
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        t_pagedIn.swap(m_pagedIn);
+    }
+    for (std::unique_ptr<PageJob> &job : t_pagedIn)
+    {
+        auto it = m_chunks.find(job->key);
+        // made resident early by an edit, or gone after a reset
+        if (it == m_chunks.end() || it->second.state != ChunkState::PagingIn)
+            continue;
+        if (!job->read)
+        {
+            std::cout << "OBJECT::PAGE_IN::READ_FAILED (" << job->key.x << ", " << job->key.y << ", " << job->key.z << ")" << std::endl;
+            dropOccupancy(job->key);
+        }
+        makeResident(it->second, job->voxels);
+        m_pagingStats.lastPageInTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - job->start).count();
+        m_pagingStats.totalPageInTime += m_pagingStats.lastPageInTime;
+        m_pagingStats.pageIns++;
+    }
 
-    m_shader.SetVec3("light.direction", light.direction);
-    m_shader.SetVec3("light.ambient", light.ambient);
-    m_shader.SetVec3("light.diffuse", light.diffuse);
-    m_shader.SetVec3("light.specular", light.specular);
+    glm::ivec3 t_center = ChunkMap::ChunkCoord(glm::ivec3(glm::floor(cameraPosition + glm::vec3(0.5f))));
+    std::vector<std::pair<uint64_t, glm::ivec3>> t_evictable;
+    uint32_t t_resident = 0;
+    for (auto &entry : m_chunks)
+    {
+        ChunkMesh &chunk = entry.second;
+        bool t_near = glm::all(glm::lessThanEqual(glm::abs(entry.first - t_center), glm::ivec3(PAGING_RADIUS)));
+        if (chunk.state == ChunkState::Resident)
+        {
+            t_resident++;
+            // the level wanted out here has to be built first, evicted
+            // chunks cannot be meshed
+            bool t_meshed = !chunk.meshing && !chunk.dirty && !chunk.lods[chunk.lod].dirty;
+            if (t_near)
+                chunk.lastUsed = m_frame;
+            else if (t_meshed)
+                t_evictable.push_back(std::make_pair(chunk.lastUsed, entry.first));
+        }
+        else if (chunk.state == ChunkState::Evicted && t_near && chunk.mappedVoxels)
+        {
+            // still backed by the mapped model, nothing to read
+            std::vector<Voxel> t_none;
+            makeResident(chunk, t_none);
+        }
+        else if (chunk.state == ChunkState::Evicted && t_near)
+        {
+            chunk.state = ChunkState::PagingIn;
+            PageJob *t_job = new PageJob;
+            t_job->key = entry.first;
+            t_job->start = std::chrono::steady_clock::now();
+            m_jobSystem->Submit([this, t_job]()
+            {
+                t_job->read = m_region.Read(t_job->key, t_job->voxels);
+                std::lock_guard<std::mutex> lock(m_finishedMutex);
+                m_pagedIn.emplace_back(t_job);
+            });
+        }
+    }
 
-    m_shader.SetMat4("projection", mvp.projection);
-    m_shader.SetMat4("view", mvp.view);
+    if (t_resident <= MAX_RESIDENT_CHUNKS)
+        return;
+    std::sort(t_evictable.begin(), t_evictable.end(),
+              [](const std::pair<uint64_t, glm::ivec3> &a, const std::pair<uint64_t, glm::ivec3> &b)
+              { return a.first < b.first; });
+    // written chunks keep their voxels until the write backs of the whole
+    // pass are flushed, after a failed flush they stay resident and modified
+    std::vector<glm::ivec3> t_written;
+    for (size_t i = 0; i < t_evictable.size() && t_resident > MAX_RESIDENT_CHUNKS; i++)
+    {
+        glm::ivec3 t_key = t_evictable[i].second;
+        ChunkMesh &chunk = m_chunks[t_key];
+        // an untouched mapped chunk keeps the mapping as its backing store
+        if (chunk.mappedVoxels)
+        {
+            t_resident--;
+            evictChunk(chunk);
+            continue;
+        }
+        bool t_write = chunk.modified || !m_region.Contains(t_key);
+        if (t_write && !m_region.Write(t_key, chunk.voxels))
+            continue;
+        t_resident--;
+        if (t_write)
+            t_written.push_back(t_key);
+        else
+            evictChunk(chunk);
+    }
+    if (t_written.empty() || !m_region.Flush())
+        return;
+    for (glm::ivec3 key : t_written)
+    {
+        ChunkMesh &chunk = m_chunks[key];
+        chunk.modified = false;
+        evictChunk(chunk);
+    }
+}
 
-    glm::mat4 objectModel = mvp.model;
+// Drops the voxels and full detail mesh of a chunk whose voxels are in the
+// region file or still in the mapped model. The coarse meshes keep drawing it
+// and the occupancy stays in m_chunkMap for neighbour culling and picking.
+void Object::evictChunk(ChunkMesh &chunk)
+{
+    dropMeshStats(chunk);
+    deleteLodMesh(chunk.lods[0]);
+    std::vector<Voxel>().swap(chunk.voxels);
+    std::unordered_map<glm::ivec3, uint32_t, ChunkKeyHash>().swap(chunk.voxelIndex);
+    std::vector<Box>().swap(chunk.occluders);
+    chunk.state = ChunkState::Evicted;
+}
 
-    glBindVertexArray(m_VAO);
+// voxels are the ones read from the region file, a chunk still backed by
+// the mapped model is unpacked again on its next remesh
+void Object::makeResident(ChunkMesh &chunk, std::vector<Voxel> &voxels)
+{
+    chunk.state = ChunkState::Resident;
+    chunk.dirty = true;
+    chunk.lastUsed = m_frame;
+    if (chunk.mappedVoxels)
+        return;
+    chunk.modified = false;
+    chunk.voxels.swap(voxels);
+    chunk.voxelIndex.clear();
+    for (uint32_t i = 0; i < chunk.voxels.size(); i++)
+        chunk.voxelIndex[glm::ivec3(chunk.voxels[i].pos)] = i;
+}
 
-    for (Voxel voxel : m_voxels)
+// synchronous page in for edits and picks that hit a paged out chunk
+void Object::ensureResident(glm::ivec3 key, ChunkMesh &chunk)
+{
+    if (chunk.state == ChunkState::Resident)
+        return;
+    std::vector<Voxel> t_voxels;
+    if (!chunk.mappedVoxels && !m_region.Read(key, t_voxels))
     {
-        objectModel = glm::translate(mvp.model, voxel.pos);
-        m_shader.SetMat4("model", objectModel);
-        m_shader.SetVec3("material.ambient", voxel.mat.ambient);
-        m_shader.SetVec3("material.diffuse", voxel.mat.diffuse);
-        m_shader.SetVec3("material.specular", voxel.mat.specular);
-        m_shader.SetFloat("material.shininess", voxel.mat.shininess * 128);
-
-        glm::ivec3 t_pos = glm::ivec3(VOXEL_COUNT / 2 + voxel.pos.x, VOXEL_COUNT / 2 + voxel.pos.y, VOXEL_COUNT / 2 + voxel.pos.z);
-        //right
-        if (t_pos.x + 1 <= VOXEL_COUNT)
-            if (m_hashVoxels[t_pos.x + 1][t_pos.y][t_pos.z] == false || optimizedMode)
-                glDrawElements(GL_TRIANGLES, (GLsizei)36 / 6, GL_UNSIGNED_INT, (void *)(0 * sizeof(uint32_t)));
-        //left
-        if (t_pos.x - 1 >= 0)
-            if (m_hashVoxels[t_pos.x - 1][t_pos.y][t_pos.z] == false || optimizedMode)
-                glDrawElements(GL_TRIANGLES, (GLsizei)36 / 6, GL_UNSIGNED_INT, (void *)(6 * sizeof(uint32_t)));
-        //top
-        if (t_pos.y + 1 <= VOXEL_COUNT)
-            if (m_hashVoxels[t_pos.x][t_pos.y + 1][t_pos.z] == false || optimizedMode)
-                glDrawElements(GL_TRIANGLES, (GLsizei)36 / 6, GL_UNSIGNED_INT, (void *)(12 * sizeof(uint32_t)));
-        //bot
-        if (t_pos.y - 1 >= 0)
-            if (m_hashVoxels[t_pos.x][t_pos.y - 1][t_pos.z] == false || optimizedMode)
-                glDrawElements(GL_TRIANGLES, (GLsizei)36 / 6, GL_UNSIGNED_INT, (void *)(18 * sizeof(uint32_t)));
-        //front
-        if (t_pos.z + 1 <= VOXEL_COUNT)
-            if (m_hashVoxels[t_pos.x][t_pos.y][t_pos.z + 1] == false || optimizedMode)
-                glDrawElements(GL_TRIANGLES, (GLsizei)36 / 6, GL_UNSIGNED_INT, (void *)(24 * sizeof(uint32_t)));
-        //back
-        if (t_pos.z - 1 >= 0)
-            if (m_hashVoxels[t_pos.x][t_pos.y][t_pos.z - 1] == false || optimizedMode)
-                glDrawElements(GL_TRIANGLES, (GLsizei)36 / 6, GL_UNSIGNED_INT, (void *)(30 * sizeof(uint32_t)));
+        std::cout << "OBJECT::PAGE_IN::READ_FAILED (" << key.x << ", " << key.y << ", " << key.z << ")" << std::endl;
+        dropOccupancy(key);
     }
-    return;
+    makeResident(chunk, t_voxels);
 }
 
-void Object::AddVoxel(glm::ivec3 pos, Material mat)
+// Uploads meshes finished by the job system and queues dirty chunks,
+// must run on the thread owning the GL context
+void Object::UpdateMeshes(MeshMode meshMode, bool ambientOcclusion)
 {
-    glm::ivec3 t_pos = glm::ivec3(VOXEL_COUNT / 2 + pos.x, VOXEL_COUNT / 2 + pos.y, VOXEL_COUNT / 2 + pos.z);
-    if (t_pos.x < 0 || t_pos.x > VOXEL_COUNT)
+    m_remeshStats = {0, 0.f};
+
+    std::vector<std::unique_ptr<MeshJob>> t_finished;
     {
-        std::cout << "OBJECT::ADD_VOXEL::POS::X Out of bounds " << std::endl;
-        return;
+        std::lock_guard<std::mutex> lock(m_finishedMutex);
+        t_finished.swap(m_finishedJobs);
+    }
+    for (std::unique_ptr<MeshJob> &job : t_finished)
+        uploadMesh(*job);
+    if (m_remeshStats.chunks)
+        m_meshStats.buildTime = m_remeshStats.time;
+
+    bool t_modeChanged = m_meshMode != meshMode || m_ambientOcclusion != ambientOcclusion;
+    m_meshMode = meshMode;
+    m_ambientOcclusion = ambientOcclusion;
+
+    for (auto it = m_chunks.begin(); it != m_chunks.end();)
+    {
+        ChunkMesh &chunk = it->second;
+        if (t_modeChanged)
+            chunk.dirty = true;
+        if (chunk.meshing || chunk.state != ChunkState::Resident)
+        {
+            it++;
+            continue;
+        }
+
+        if (chunk.dirty)
+        {
+            unpackChunk(it->first, chunk);
+            if (chunk.voxels.empty())
+            {
+                dropMeshStats(chunk);
+                deleteChunkMesh(chunk);
+                it = m_chunks.erase(it);
+                continue;
+            }
+            for (LodMesh &lod : chunk.lods)
+                lod.dirty = true;
+            chunk.dirty = false;
+            chunk.occluders.clear();
+            const Chunk *t_occupancy = m_chunkMap.GetChunk(it->first);
+            if (t_occupancy)
+                findOccluders(*t_occupancy, it->first, chunk.occluders);
+        }
+        if (!chunk.lods[chunk.lod].dirty)
+        {
+            it++;
+            continue;
+        }
+
+        MeshJob *t_job = new MeshJob;
+        t_job->key = it->first;
+        t_job->level = chunk.lod;
+        t_job->mode = meshMode;
+        t_job->ambientOcclusion = ambientOcclusion;
+        t_job->voxels = chunk.voxels;
+        // face culling needs the six face neighbours, AO also the edge and
+        // corner ones
+        for (int t_index = 0; t_index < 27 && chunk.lod == 0; t_index++)
+        {
+            glm::ivec3 t_offset = glm::ivec3(t_index / 9, (t_index / 3) % 3, t_index % 3) - glm::ivec3(1);
+            if (!ambientOcclusion && glm::abs(t_offset.x) + glm::abs(t_offset.y) + glm::abs(t_offset.z) > 1)
+                continue;
+            glm::ivec3 t_key = it->first + t_offset;
+            const Chunk *t_chunk = m_chunkMap.GetChunk(t_key);
+            if (t_chunk)
+                t_job->occupancy.SetChunk(t_key, *t_chunk);
+        }
+        chunk.lods[chunk.lod].dirty = false;
+        chunk.meshing = true;
+
+        m_jobSystem->Submit([this, t_job]()
+        {
+            if (t_job->level == 0)
+                t_job->stats = buildMesh(t_job->voxels, t_job->occupancy, t_job->mode, t_job->ambientOcclusion, t_job->vertices, t_job->indices);
+            else
+                t_job->stats = buildLodMesh(t_job->voxels, t_job->level, t_job->mode, t_job->ambientOcclusion, t_job->vertices, t_job->indices);
+            std::lock_guard<std::mutex> lock(m_finishedMutex);
+            m_finishedJobs.emplace_back(t_job);
+        });
+        it++;
     }
-    if (t_pos.y < 0 || t_pos.y > VOXEL_COUNT)
+}
+
+// picks the detail level of every chunk from its distance to the camera,
+// level n is used from LOD_DISTANCE * 2^(n - 1) on
+void Object::UpdateLods(glm::vec3 cameraPosition, bool enabled)
+{
+    for (auto &entry : m_chunks)
     {
-        std::cout << "OBJECT::ADD_VOXEL::POS::Y Out of bounds " << std::endl;
+        uint32_t t_level = 0;
+        if (enabled)
+        {
+            glm::vec3 t_center = glm::vec3(entry.first * CHUNK_SIZE) + glm::vec3(CHUNK_SIZE / 2.f - 0.5f);
+            float t_distance = glm::distance(t_center, cameraPosition);
+            while (t_level + 1 < LOD_LEVELS && t_distance >= LOD_DISTANCE * (float)(1 << t_level))
+                t_level++;
+        }
+        entry.second.lod = t_level;
+    }
+}
+
+void Object::SetOcclusionCulling(bool enabled)
+{
+    m_occlusionCulling = enabled;
+}
+
+// remeshes every chunk, e.g. after a model was loaded
+void Object::InvalidateMeshes()
+{
+    for (auto &entry : m_chunks)
+        entry.second.dirty = true;
+    m_instancesDirty = true;
+    m_volumeDirty = true;
+}
+
+void Object::uploadMesh(MeshJob &job)
+{
+    auto it = m_chunks.find(job.key);
+    if (it == m_chunks.end())
         return;
+    ChunkMesh &chunk = it->second;
+    LodMesh &lod = chunk.lods[job.level];
+    chunk.meshing = false;
+
+    // the totals only cover full detail meshes
+    if (job.level == 0)
+    {
+        m_meshStats.visibleFaces -= lod.stats.visibleFaces;
+        m_meshStats.quads -= lod.stats.quads;
+        m_meshStats.visibleFaces += job.stats.visibleFaces;
+        m_meshStats.quads += job.stats.quads;
     }
-    if (t_pos.z < 0 || t_pos.z > VOXEL_COUNT)
+    lod.stats = job.stats;
+    m_remeshStats.chunks++;
+    m_remeshStats.time += job.stats.buildTime;
+
+    if (!lod.built)
+        createLodMesh(lod);
+    lod.built = true;
+    glBindBuffer(GL_ARRAY_BUFFER, lod.VBO);
+    glBufferData(GL_ARRAY_BUFFER, job.vertices.size() * sizeof(MeshVertex),
+                 job.vertices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(lod.VAO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, job.indices.size() * sizeof(uint32_t),
+                 job.indices.data(), GL_DYNAMIC_DRAW);
+    glBindVertexArray(0);
+    lod.indexCount = (uint32_t)job.indices.size();
+}
+
+void Object::createChunkMesh(ChunkMesh &chunk)
+{
+    for (LodMesh &lod : chunk.lods)
+        lod = {0, 0, 0, 0, true, false, {0, 0, 0.f}};
+    chunk.lod = 0;
+    chunk.dirty = true;
+    chunk.meshing = false;
+    chunk.mappedVoxels = nullptr;
+    chunk.mappedCount = 0;
+    chunk.state = ChunkState::Resident;
+    chunk.modified = true;
+    chunk.lastUsed = m_frame;
+}
+
+void Object::createLodMesh(LodMesh &lod)
+{
+    glGenVertexArrays(1, &lod.VAO);
+    glBindVertexArray(lod.VAO);
+
+    glGenBuffers(1, &lod.VBO);
+    glGenBuffers(1, &lod.EBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, lod.VBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lod.EBO);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(MeshVertex), (void *)offsetof(MeshVertex, packed));
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(MeshVertex), (void *)offsetof(MeshVertex, material));
+    glBindVertexArray(0);
+}
+
+void Object::deleteChunkMesh(ChunkMesh &chunk)
+{
+    for (LodMesh &lod : chunk.lods)
+        deleteLodMesh(lod);
+}
+
+void Object::deleteLodMesh(LodMesh &lod)
+{
+    if (!lod.built)
+        return;
+    glDeleteVertexArrays(1, &lod.VAO);
+    glDeleteBuffers(1, &lod.VBO);
+    glDeleteBuffers(1, &lod.EBO);
+    lod = {0, 0, 0, 0, true, false, {0, 0, 0.f}};
+}
+
+void Object::dropMeshStats(ChunkMesh &chunk)
+{
+    m_meshStats.visibleFaces -= chunk.lods[0].stats.visibleFaces;
+    m_meshStats.quads -= chunk.lods[0].stats.quads;
+}
+
+// marks the chunk of pos dirty, and its neighbours when pos is on a border
+void Object::markDirty(glm::ivec3 pos)
+{
+    m_instancesDirty = true;
+    m_volumeChunks.insert(ChunkMap::ChunkCoord(pos));
+    // every chunk touching the 3x3x3 cells around pos, corner AO of their
+    // faces can depend on this voxel
+    glm::ivec3 t_min = ChunkMap::ChunkCoord(pos - glm::ivec3(1));
+    glm::ivec3 t_max = ChunkMap::ChunkCoord(pos + glm::ivec3(1));
+    for (int x = t_min.x; x <= t_max.x; x++)
+        for (int y = t_min.y; y <= t_max.y; y++)
+            for (int z = t_min.z; z <= t_max.z; z++)
+            {
+                auto it = m_chunks.find(glm::ivec3(x, y, z));
+                if (it != m_chunks.end())
+                    it->second.dirty = true;
+            }
+}
+
+void Object::AddVoxel(glm::ivec3 pos, MaterialID mat)
+{
+    if (glm::any(glm::lessThan(pos, glm::ivec3(std::numeric_limits<int16_t>::min()))) ||
+        glm::any(glm::greaterThan(pos, glm::ivec3(std::numeric_limits<int16_t>::max()))))
     {
-        std::cout << "OBJECT::ADD_VOXEL::POS::Z Out of bounds " << std::endl;
+        std::cout << "OBJECT::ADD_VOXEL::POS Out of bounds " << std::endl;
         return;
     }
-    if (m_hashVoxels[t_pos.x][t_pos.y][t_pos.z])
+    if (m_chunkMap.Get(pos))
     {
         std::cout << "OBJECT::ADD_VOXEL Voxel already here" << std::endl;
         return;
@@ -117,42 +671,74 @@ void Object::AddVoxel(glm::ivec3 pos, Material mat)
     Voxel t_voxel;
     t_voxel.pos = pos;
     t_voxel.mat = mat;
-    m_voxels.push_back(t_voxel);
-    m_hashVoxels[t_pos.x][t_pos.y][t_pos.z] = true;
+    insertVoxel(t_voxel);
+    markDirty(pos);
     std::cout << "OBJECT::ADD_VOXEL (" << t_voxel.pos.x << ", "
               << t_voxel.pos.y << ", " << t_voxel.pos.z << ") ("
-              << t_voxel.mat.name << ")" << std::endl;
+              << getMaterial(t_voxel.mat).name << ")" << std::endl;
+}
+
+// adds a voxel to its chunk without any checks, the caller marks meshes dirty
+void Object::insertVoxel(Voxel voxel)
+{
+    glm::ivec3 t_pos = glm::ivec3(voxel.pos);
+    glm::ivec3 t_key = ChunkMap::ChunkCoord(t_pos);
+    auto it = m_chunks.find(t_key);
+    if (it == m_chunks.end())
+    {
+        it = m_chunks.emplace(t_key, ChunkMesh()).first;
+        createChunkMesh(it->second);
+    }
+    ensureResident(t_key, it->second);
+    unpackChunk(t_key, it->second);
+    it->second.modified = true;
+    it->second.voxelIndex[t_pos] = (uint32_t)it->second.voxels.size();
+    it->second.voxels.push_back(voxel);
+    m_chunkMap.Set(t_pos, true);
+    m_brickMap.Set(t_pos);
 }
 
-void Object::ChangeColor(Voxel *voxel, Material mat)
+void Object::ChangeColor(Voxel *voxel, MaterialID mat)
 {
     voxel->mat = mat;
+    ChunkMesh &chunk = m_chunks[ChunkMap::ChunkCoord(glm::ivec3(voxel->pos))];
+    chunk.dirty = true;
+    chunk.modified = true;
+    m_instancesDirty = true;
+    m_volumeChunks.insert(ChunkMap::ChunkCoord(glm::ivec3(voxel->pos)));
 }
 
 void Object::RemoveVoxel(Voxel *voxel)
 {
-    glm::ivec3 t_pos = glm::ivec3(VOXEL_COUNT / 2 + voxel->pos.x, VOXEL_COUNT / 2 + voxel->pos.y, VOXEL_COUNT / 2 + voxel->pos.z);
-    m_hashVoxels[t_pos.x][t_pos.y][t_pos.z] = false;
-    m_voxels.erase(m_voxels.begin() + (voxel - &m_voxels.front()));
+    glm::ivec3 t_pos = glm::ivec3(voxel->pos);
+    ChunkMesh &chunk = m_chunks[ChunkMap::ChunkCoord(t_pos)];
+    m_chunkMap.Set(t_pos, false);
+    m_brickMap.Remove(t_pos);
+
+    // move the last voxel into the hole instead of shifting the rest
+    size_t t_index = voxel - &chunk.voxels.front();
+    chunk.voxelIndex.erase(t_pos);
+    if (t_index != chunk.voxels.size() - 1)
+    {
+        chunk.voxels[t_index] = chunk.voxels.back();
+        chunk.voxelIndex[glm::ivec3(chunk.voxels[t_index].pos)] = (uint32_t)t_index;
+    }
+    chunk.voxels.pop_back();
+    chunk.modified = true;
+    markDirty(t_pos);
 }
 
 void Object::RemoveVoxel(glm::vec3 pos)
 {
     std::cout << "OBJECT::REMOVE_VOXEL ";
-    glm::ivec3 t_pos = glm::ivec3(VOXEL_COUNT / 2 + pos.x, VOXEL_COUNT / 2 + pos.y, VOXEL_COUNT / 2 + pos.z);
-    if (m_hashVoxels[t_pos.x][t_pos.y][t_pos.z] == true)
+    glm::ivec3 t_pos = glm::ivec3(pos);
+    Voxel *t_voxel = findVoxel(t_pos);
+    if (t_voxel)
     {
-        m_hashVoxels[t_pos.x][t_pos.y][t_pos.z] = false;
-        for (int i = 0; i < m_voxels.size(); i++)
-        {
-            if (m_voxels[i].pos == pos)
-            {
-                std::cout << "(" << pos.x << ", " << pos.y << ", " << pos.z << ") ";
-                m_voxels.erase(m_voxels.begin() + (&m_voxels[i] - &m_voxels.front()));
-                std::cout << "ERASED" << std::endl;
-                return;
-            }
-        }
+        std::cout << "(" << pos.x << ", " << pos.y << ", " << pos.z << ") ";
+        RemoveVoxel(t_voxel);
+        std::cout << "ERASED" << std::endl;
+        return;
     }
     else
     {
@@ -164,25 +750,59 @@ void Object::Reset()
 {
     std::cout << "OBJECT::RESET " << name << " ";
     name = "new_object";
-    memset(m_hashVoxels, 0, sizeof(m_hashVoxels));
-    m_voxels.clear();
+    m_jobSystem->Wait();
+    m_finishedJobs.clear();
+    m_pagedIn.clear();
+    m_region.Clear();
+    m_chunkMap.Clear();
+    m_brickMap.Clear();
+    for (auto &entry : m_chunks)
+        deleteChunkMesh(entry.second);
+    m_chunks.clear();
+    m_mappedFile.reset();
+    m_mappedPalette.clear();
+    m_meshStats = {0, 0, 0.f};
+    m_instancesDirty = true;
+    m_volumeDirty = true;
+    m_volumeChunks.clear();
     std::cout << std::endl;
 }
 
-void Object::Save()
+// materials are stored by name, the palette IDs only live as long as the process
+VoxelModel Object::toModel()
 {
-    std::cout << "OBJECT::SAVE " << std::string(FILES_PATH) + name + std::string(VOXEL_FILE_EXTENSION) << " ";
-    std::ofstream file(std::string(FILES_PATH) + name + std::string(VOXEL_FILE_EXTENSION));
-    if (file.bad() || file.fail())
+    VoxelModel t_model;
+    t_model.voxels = GetListOfVoxels();
+    std::unordered_map<MaterialID, uint16_t> t_materialIndex;
+    for (Voxel &voxel : t_model.voxels)
     {
-        std::cout << "FILE_BAD" << std::endl;
-        return;
-    }
-    for (Voxel voxel : m_voxels)
-    {
-        file << voxel.pos.x << " " << voxel.pos.y << " " << voxel.pos.z << " " << voxel.mat.name << std::endl;
+        auto it = t_materialIndex.find(voxel.mat);
+        if (it == t_materialIndex.end())
+        {
+            it = t_materialIndex.emplace(voxel.mat, (uint16_t)t_model.materials.size()).first;
+            t_model.materials.push_back(getMaterial(voxel.mat).name);
+        }
+        voxel.mat = it->second;
     }
-    file.close();
+    return t_model;
+}
+
+void Object::Save()
+{
+    std::string t_path = std::string(FILES_PATH) + name + std::string(VOXEL_FILE_EXTENSION);
+    std::cout << "OBJECT::SAVE " << t_path << " ";
+    if (!saveVoxelFile(t_path, toModel()))
+        return;
+    std::cout << std::endl;
+    return;
+}
+
+void Object::Export()
+{
+    std::string t_path = std::string(FILES_PATH) + name + std::string(VOXEL_TEXT_FILE_EXTENSION);
+    std::cout << "OBJECT::EXPORT " << t_path << " ";
+    if (!exportVoxelText(t_path, toModel()))
+        return;
     std::cout << std::endl;
     return;
 }
@@ -190,130 +810,229 @@ void Object::Save()
 void Object::Load(std::string objectPath)
 {
     std::cout << "OBJECT::LOAD " << objectPath << " ";
-    std::ifstream file(objectPath);
-    if (file.bad() || file.fail())
+    bool t_binary = isBinaryVoxelFile(objectPath);
+    if (t_binary)
     {
-        std::cout << "FILE_BAD" << std::endl;
-        return;
+        // version 2 files are used in place, Open fails without reading the
+        // payload for older versions and those are decoded below
+        std::unique_ptr<VoxelFileView> t_view(new VoxelFileView);
+        if (t_view->Open(objectPath))
+        {
+            Reset();
+            // only occupancy and the brick map are filled, both from the
+            // chunks' occupancy masks; voxels stay in the mapping until used
+            for (const std::string &matName : t_view->GetMaterials())
+                m_mappedPalette.push_back(registerMaterial(loadMaterial(matName)));
+            size_t t_count = 0;
+            for (const MappedChunk &mapped : t_view->GetChunks())
+            {
+                ChunkMesh &chunk = m_chunks.emplace(mapped.coord, ChunkMesh()).first->second;
+                createChunkMesh(chunk);
+                chunk.mappedVoxels = mapped.voxels;
+                chunk.mappedCount = mapped.voxelCount;
+                m_chunkMap.SetChunk(mapped.coord, *mapped.occupancy);
+                m_brickMap.SetChunk(mapped.coord, mapped.occupancy);
+                t_count += mapped.voxelCount;
+            }
+            m_mappedFile = std::move(t_view);
+            std::cout << t_count << " voxels mapped" << std::endl;
+            return;
+        }
     }
+
+    VoxelModel t_model;
+    bool t_loaded = t_binary ? loadVoxelFile(objectPath, t_model) : importVoxelText(objectPath, t_model);
+    if (!t_loaded)
+        return;
     Reset();
-    glm::ivec3 t_pos;
-    std::string t_matName;
-    while (!file.eof())
+
+    std::vector<MaterialID> t_palette;
+    for (const std::string &matName : t_model.materials)
+        t_palette.push_back(registerMaterial(loadMaterial(matName)));
+    for (Voxel voxel : t_model.voxels)
     {
-        file >> t_pos.x;
-        file >> t_pos.y;
-        file >> t_pos.z;
-        file >> t_matName;
-        AddVoxel(t_pos, loadMaterial(t_matName));
+        if (m_chunkMap.Get(glm::ivec3(voxel.pos)))
+            continue;
+        voxel.mat = t_palette[voxel.mat];
+        insertVoxel(voxel);
     }
+    InvalidateMeshes();
+    std::cout << t_model.voxels.size() << " voxels" << std::endl;
     return;
 }
 
 Voxel *Object::CheckRay(glm::vec3 ray_origin, glm::vec3 ray_dir, glm::vec3 &newBlockLoc)
 {
     // return pointer to hitVoxel
-    Voxel *ray_hit = nullptr;
-    float ray_distance = MAX_RAY_RANGE;
-    int ray_axis;
+    RayHit t_hit = m_brickMap.CastRay(ray_origin, ray_dir, MAX_RAY_RANGE);
+    if (!t_hit.hit)
+        return nullptr;
 
-    for (int i = 0; i < m_voxels.size(); i++)
-    {
-        glm::vec3 max = m_voxels[i].pos + glm::vec3(0.5f);
-        glm::vec3 min = m_voxels[i].pos - glm::vec3(0.5f);
+    Voxel *t_voxel = findVoxel(t_hit.cell);
+    if (!t_voxel)
+        return nullptr;
+    newBlockLoc = glm::vec3(t_hit.normal);
+    std::cout << "(" << t_voxel->pos.x << ", " << t_voxel->pos.y << ", " << t_voxel->pos.z << ") at distance: " << t_hit.distance << std::endl;
+    return t_voxel;
+}
 
-        float tmin = (min.x - ray_origin.x) / ray_dir.x;
-        float t1 = tmin;
-        float tmax = (max.x - ray_origin.x) / ray_dir.x;
-        float t2 = tmax;
+// The voxel records are checked against the chunk's occupancy on first use,
+// which is still the file's since every edit unpacks the chunk first. A bad
+// chunk is dropped with its occupancy instead of indexing bad positions.
+void Object::unpackChunk(glm::ivec3 key, ChunkMesh &chunk)
+{
+    if (!chunk.mappedVoxels)
+        return;
+    const Chunk *t_occupancy = m_chunkMap.GetChunk(key);
+    if (!t_occupancy || !checkMappedChunk({key, t_occupancy, chunk.mappedVoxels, chunk.mappedCount}))
+    {
+        std::cout << "OBJECT::UNPACK::BAD_CHUNK (" << key.x << ", " << key.y << ", " << key.z << ")" << std::endl;
+        dropOccupancy(key);
+        chunk.mappedVoxels = nullptr;
+        chunk.mappedCount = 0;
+        return;
+    }
+    chunk.voxels.reserve(chunk.voxels.size() + chunk.mappedCount);
+    for (uint32_t i = 0; i < chunk.mappedCount; i++)
+    {
+        Voxel t_voxel = chunk.mappedVoxels[i];
+        t_voxel.mat = t_voxel.mat < m_mappedPalette.size() ? m_mappedPalette[t_voxel.mat] : 0;
+        chunk.voxelIndex[glm::ivec3(t_voxel.pos)] = (uint32_t)chunk.voxels.size();
+        chunk.voxels.push_back(t_voxel);
+    }
+    chunk.mappedVoxels = nullptr;
+    chunk.mappedCount = 0;
+}
 
-        if (tmin > tmax)
-            std::swap(tmin, tmax);
+// Clears the occupancy of a chunk whose voxels are lost, the chunk itself is
+// erased once it is remeshed without voxels
+void Object::dropOccupancy(glm::ivec3 key)
+{
+    const Chunk *t_occupancy = m_chunkMap.GetChunk(key);
+    if (t_occupancy)
+    {
+        // the chunk map frees the chunk with its last bit, so walk a copy
+        Chunk t_bits = *t_occupancy;
+        for (int x = 0; x < CHUNK_SIZE; x++)
+            for (int y = 0; y < CHUNK_SIZE; y++)
+                for (int z = 0; z < CHUNK_SIZE; z++)
+                    if ((t_bits.columns[x][y] >> z) & 1u)
+                        m_chunkMap.Set(key * CHUNK_SIZE + glm::ivec3(x, y, z), false);
+    }
+    m_brickMap.SetChunk(key, nullptr);
+    // neighbours culled faces against the dropped voxels
+    for (int x = -1; x <= 1; x++)
+        for (int y = -1; y <= 1; y++)
+            for (int z = -1; z <= 1; z++)
+            {
+                auto it = m_chunks.find(key + glm::ivec3(x, y, z));
+                if (it != m_chunks.end())
+                    it->second.dirty = true;
+            }
+    m_instancesDirty = true;
+    m_volumeDirty = true;
+}
 
-        float tymin = (min.y - ray_origin.y) / ray_dir.y;
-        float t3 = tymin;
-        float tymax = (max.y - ray_origin.y) / ray_dir.y;
-        float t4 = tymax;
+Voxel *Object::findVoxel(glm::ivec3 pos)
+{
+    auto t_chunk = m_chunks.find(ChunkMap::ChunkCoord(pos));
+    if (t_chunk == m_chunks.end())
+        return nullptr;
+    ensureResident(t_chunk->first, t_chunk->second);
+    unpackChunk(t_chunk->first, t_chunk->second);
+    auto t_index = t_chunk->second.voxelIndex.find(pos);
+    if (t_index == t_chunk->second.voxelIndex.end())
+        return nullptr;
+    return &t_chunk->second.voxels[t_index->second];
+}
 
-        if (tymin > tymax)
-            std::swap(tymin, tymax);
+size_t Object::GetVoxelCount()
+{
+    size_t t_count = 0;
+    for (auto &entry : m_chunks)
+    {
+        const Chunk *t_chunk = m_chunkMap.GetChunk(entry.first);
+        if (t_chunk)
+            t_count += t_chunk->voxelCount;
+    }
+    return t_count;
+}
 
-        if ((tmin > tymax) || (tymin > tmax))
+std::vector<Voxel> Object::GetListOfVoxels()
+{
+    std::vector<Voxel> t_voxels;
+    std::vector<Voxel> t_paged;
+    for (auto &entry : m_chunks)
+    {
+        // paged out chunks are read without making them resident again,
+        // except mapped ones since the mapping is released below
+        if (entry.second.mappedVoxels)
+            ensureResident(entry.first, entry.second);
+        if (entry.second.state != ChunkState::Resident)
+        {
+            m_region.Read(entry.first, t_paged);
+            t_voxels.insert(t_voxels.end(), t_paged.begin(), t_paged.end());
             continue;
+        }
+        unpackChunk(entry.first, entry.second);
+        t_voxels.insert(t_voxels.end(), entry.second.voxels.begin(), entry.second.voxels.end());
+    }
+    // nothing points into the mapping anymore, the file may be overwritten
+    m_mappedFile.reset();
+    return t_voxels;
+}
 
-        if (tymin > tmin)
-            tmin = tymin;
-
-        if (tymax < tmax)
-            tmax = tymax;
+MeshStats Object::GetMeshStats()
+{
+    return m_meshStats;
+}
 
-        float tzmin = (min.z - ray_origin.z) / ray_dir.z;
-        float t5 = tzmin;
-        float tzmax = (max.z - ray_origin.z) / ray_dir.z;
-        float t6 = tzmax;
+VolumeStats Object::GetVolumeStats()
+{
+    return m_volume.GetStats();
+}
 
-        if (tzmin > tzmax)
-            std::swap(tzmin, tzmax);
+const ChunkMap &Object::GetChunkMap()
+{
+    return m_chunkMap;
+}
 
-        if ((tmin > tzmax) || (tzmin > tmax))
-            continue;
+const BrickMap &Object::GetBrickMap()
+{
+    return m_brickMap;
+}
 
-        if (tzmin > tmin)
-            tmin = tzmin;
+RemeshStats Object::GetRemeshStats()
+{
+    return m_remeshStats;
+}
 
-        if (tzmax < tmax)
-            tmax = tzmax;
+LodStats Object::GetLodStats()
+{
+    return m_lodStats;
+}
 
-        float distance = glm::distance(m_voxels[i].pos, ray_origin);
+CullStats Object::GetCullStats()
+{
+    return m_cullStats;
+}
 
-        if (distance < ray_distance)
-        {
-            float t_tminx = fmin(t1, t2);
-            float t_tminy = fmin(t3, t4);
-            float t_tmin = fmax(fmax(t_tminx, t_tminy), fmin(t5, t6));
-            ray_axis = 2;
-            if (t_tmin == t_tminx)
-                ray_axis = 0;
-            if (t_tmin == t_tminy)
-                ray_axis = 1;
-
-            ray_hit = &m_voxels[i];
-            ray_distance = distance;
-        }
-    }
-    if (ray_distance == MAX_RAY_RANGE)
-    {
-        return nullptr;
-    }
-    else
+PagingStats Object::GetPagingStats()
+{
+    m_pagingStats.residentChunks = 0;
+    m_pagingStats.evictedChunks = 0;
+    m_pagingStats.residentBytes = 0;
+    for (auto &entry : m_chunks)
     {
-        if (ray_axis == 2)
+        if (entry.second.state != ChunkState::Resident)
         {
-            if (ray_origin.z - ray_hit->pos.z > 0)
-                newBlockLoc.z = 1.f;
-            else
-                newBlockLoc.z = -1.f;
-        }
-        else if (ray_axis == 1)
-        {
-            if (ray_origin.y - ray_hit->pos.y > 0)
-                newBlockLoc.y = 1.f;
-            else
-                newBlockLoc.y = -1.f;
-        }
-        else if (ray_axis == 0)
-        {
-            if (ray_origin.x - ray_hit->pos.x > 0)
-                newBlockLoc.x = 1.f;
-            else
-                newBlockLoc.x = -1.f;
+            m_pagingStats.evictedChunks++;
+            continue;
         }
-        std::cout << "(" << ray_hit->pos.x << ", " << ray_hit->pos.y << ", " << ray_hit->pos.z << ") at distance: " << ray_distance << std::endl;
-        return ray_hit;
+        m_pagingStats.residentChunks++;
+        m_pagingStats.residentBytes += entry.second.voxels.capacity() * sizeof(Voxel) +
+                                       entry.second.voxelIndex.size() * (sizeof(glm::ivec3) + sizeof(uint32_t));
     }
-}
-
-std::vector<Voxel> Object::GetListOfVoxels()
-{
-    return m_voxels;
+    m_pagingStats.regionBytes = m_region.GetFileSize();
+    return m_pagingStats;
 }
\ No newline at end of file
@@ -1,40 +1,245 @@
 #include "../shader/shader.hpp"
 #include "../material/material.hpp"
 #include "../file_handler/file_handler.hpp"
+#include "../mesher/mesher.hpp"
+#include "../chunk/chunk.hpp"
+#include "../job_system/job_system.hpp"
+#include "../raycast/raycast.hpp"
+#include "../voxel_file/voxel_file.hpp"
+#include "../region/region.hpp"
+#include "../culling/culling.hpp"
+#include "../raymarch/raymarch.hpp"
+#include "../brickmap/brickmap.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
 #include <vector>
 
 #ifndef OBJECT_HPP
 #define OBJECT_HPP
 
+enum class ChunkState
+{
+  Resident, // voxels in memory
+  PagingIn, // a job is reading the voxels back from the region file
+  Evicted   // voxels only in the region file or the mapped model, coarse meshes only
+};
+
+// GPU mesh of one detail level, buffers are created on the first upload
+struct LodMesh
+{
+  uint32_t VAO, VBO, EBO;
+  uint32_t indexCount;
+  bool dirty;
+  bool built; // uploaded at least once, may be drawn while stale
+  MeshStats stats;
+};
+
+// Voxels of one chunk together with their GPU meshes
+struct ChunkMesh
+{
+  ChunkState state;
+  bool modified;     // differs from the copy in the region file
+  uint64_t lastUsed; // frame the chunk was last near the camera
+  LodMesh lods[LOD_LEVELS];
+  uint32_t lod; // level wanted at the current camera distance
+  bool dirty;   // voxels changed, every level has to be rebuilt
+  bool meshing; // a job is building one of the levels
+  std::vector<Voxel> voxels;
+  std::unordered_map<glm::ivec3, uint32_t, ChunkKeyHash> voxelIndex; // pos -> index in voxels
+  std::vector<Box> occluders; // solid blocks, found when the chunk is remeshed
+  // voxels still in the mapped model file, moved into voxels on first use
+  const Voxel *mappedVoxels;
+  uint32_t mappedCount;
+};
+
+// Input and output of one meshing job, the job only reads its own copies so
+// the chunk can be edited while it runs
+struct MeshJob
+{
+  glm::ivec3 key;
+  uint32_t level;
+  MeshMode mode;
+  bool ambientOcclusion;
+  std::vector<Voxel> voxels;
+  ChunkMap occupancy; // the chunk and its 26 neighbours, full detail only
+  std::vector<MeshVertex> vertices;
+  std::vector<uint32_t> indices;
+  MeshStats stats;
+};
+
+// A chunk read back from the region file by the job system
+struct PageJob
+{
+  glm::ivec3 key;
+  std::vector<Voxel> voxels;
+  bool read; // false if the region file could not be read
+  std::chrono::steady_clock::time_point start;
+};
+
+struct PagingStats
+{
+  uint32_t residentChunks;
+  uint32_t evictedChunks;
+  size_t residentBytes;  // voxels and their index
+  size_t regionBytes;    // size of the region file
+  uint32_t pageIns;      // since the object was created
+  float lastPageInTime;  // ms from request to the voxels being usable
+  float totalPageInTime; // ms
+};
+
+// uniforms of basic.vert/basic.frag, resolved once after linking
+struct BasicUniforms
+{
+  Uniform viewPos;
+  Uniform lightDirection;
+  Uniform lightAmbient;
+  Uniform lightDiffuse;
+  Uniform lightSpecular;
+  Uniform projection;
+  Uniform view;
+  Uniform model;
+};
+
+enum class RenderMode
+{
+  Chunks,   // one face culled mesh per chunk
+  Instanced, // one cube instance per voxel in a single draw call
+  RayMarch   // one fullscreen triangle marching a 3D texture of the voxels
+};
+
+struct CullStats
+{
+  uint32_t drawnChunks;
+  uint32_t culledChunks;   // outside the view frustum
+  uint32_t occludedChunks; // hidden behind occluders
+  uint32_t occluders;      // rasterized into the occlusion buffer
+};
+
+struct LodStats
+{
+  uint32_t chunks[LOD_LEVELS];    // drawn at each level last frame
+  uint32_t triangles[LOD_LEVELS];
+};
+
+struct RemeshStats
+{
+  uint32_t chunks; // chunk meshes uploaded during the last frame
+  float time;      // ms spent meshing them, summed over all threads
+};
+
 class Object
 {
 public:
-  Object();
-  void Draw(MVP mvp, glm::vec3 cameraPosition, Light light, bool optimizedMode);
-  void AddVoxel(glm::ivec3 pos, Material mat);
-  void ChangeColor(Voxel *voxel, Material mat);
+  Object(JobSystem *jobSystem);
+  void UpdateResidency(glm::vec3 cameraPosition);
+  void UpdateLods(glm::vec3 cameraPosition, bool enabled);
+  void UpdateMeshes(MeshMode meshMode, bool ambientOcclusion);
+  void InvalidateMeshes();
+  void SetOcclusionCulling(bool enabled);
+  void Draw(MVP mvp, glm::vec3 cameraPosition, Light light, RenderMode renderMode);
+  void AddVoxel(glm::ivec3 pos, MaterialID mat);
+  void ChangeColor(Voxel *voxel, MaterialID mat);
   void RemoveVoxel(Voxel *voxel);
   void RemoveVoxel(glm::vec3 pos);
   void Reset();
   void Save();
+  void Export();
   void Load(std::string objectPath);
   Voxel *CheckRay(glm::vec3 ray_origin, glm::vec3 ray_dir, glm::vec3 &newBlockLoc);
   std::vector<Voxel> GetListOfVoxels();
+  size_t GetVoxelCount();
+  MeshStats GetMeshStats();
+  RemeshStats GetRemeshStats();
+  PagingStats GetPagingStats();
+  CullStats GetCullStats();
+  LodStats GetLodStats();
+  VolumeStats GetVolumeStats();
+  const ChunkMap &GetChunkMap();
+  const BrickMap &GetBrickMap();
 
   std::string name;
 
 private:
-  uint32_t m_VAO, m_VBO, m_EBO;
+  void useShader(Shader &shader, const BasicUniforms &uniforms, MVP mvp,
+                 glm::vec3 cameraPosition, Light light);
+  void initInstancing();
+  void updateInstances();
+  void updatePalette();
+  void updateVolume();
+  void uploadMesh(MeshJob &job);
+  void createChunkMesh(ChunkMesh &chunk);
+  void createLodMesh(LodMesh &lod);
+  void deleteChunkMesh(ChunkMesh &chunk);
+  void deleteLodMesh(LodMesh &lod);
+  void dropMeshStats(ChunkMesh &chunk);
+  void markDirty(glm::ivec3 pos);
+  Voxel *findVoxel(glm::ivec3 pos);
+  void unpackChunk(glm::ivec3 key, ChunkMesh &chunk);
+  void dropOccupancy(glm::ivec3 key);
+  void makeResident(ChunkMesh &chunk, std::vector<Voxel> &voxels);
+  void ensureResident(glm::ivec3 key, ChunkMesh &chunk);
+  void evictChunk(ChunkMesh &chunk);
+  void insertVoxel(Voxel voxel);
+  VoxelModel toModel();
+
   Shader m_shader;
-  std::vector<Vertex> m_vertices;
-  std::vector<uint32_t> m_indices;
-  std::vector<Voxel> m_voxels;
-  bool m_hashVoxels[VOXEL_COUNT][VOXEL_COUNT][VOXEL_COUNT];
+  BasicUniforms m_uniforms;
+  Uniform m_chunkOriginUniform, m_meshMaterialsUniform;
+  MeshMode m_meshMode;
+  bool m_ambientOcclusion;
+  MeshStats m_meshStats;
+  RemeshStats m_remeshStats;
+  std::unordered_map<glm::ivec3, ChunkMesh, ChunkKeyHash> m_chunks;
+  ChunkMap m_chunkMap;
+  BrickMap m_brickMap; // occupancy only, answers ray queries
+  JobSystem *m_jobSystem;
+  std::mutex m_finishedMutex;
+  std::vector<std::unique_ptr<MeshJob>> m_finishedJobs;
+  CullStats m_cullStats;
+  BoxList m_chunkBoxes;
+  LodStats m_lodStats;
+  std::vector<const ChunkMesh *> m_drawChunks;
+  std::vector<uint32_t> m_drawLevels;
+  std::vector<glm::ivec3> m_drawOrigins;
+  std::vector<uint8_t> m_chunkVisible;
+  bool m_occlusionCulling;
+  OcclusionBuffer m_occlusion;
+  std::vector<Box> m_occluders;
+  std::vector<std::unique_ptr<PageJob>> m_pagedIn;
+  RegionFile m_region;
+  PagingStats m_pagingStats;
+  uint64_t m_frame;
+  std::unique_ptr<VoxelFileView> m_mappedFile;
+  std::vector<MaterialID> m_mappedPalette; // file material -> palette
+
+  // material palette as a buffer texture, read by both render modes
+  uint32_t m_paletteTBO, m_paletteTexture;
+  uint32_t m_paletteVersion;
+
+  // instanced rendering, the instance buffer holds the Voxel structs as is
+  Shader m_instancedShader;
+  BasicUniforms m_instancedUniforms;
+  Uniform m_materialsUniform;
+  uint32_t m_cubeVAO, m_cubeVBO, m_cubeEBO, m_instanceVBO;
+  uint32_t m_cubeIndexCount;
+  uint32_t m_instanceCount;
+  bool m_instancesDirty;
+
+  // ray marching, edited chunks are rewritten in place and the whole volume
+  // is uploaded again only when the object grows out of it
+  VolumeRenderer m_volume;
+  bool m_volumeDirty;
+  std::unordered_set<glm::ivec3, ChunkKeyHash> m_volumeChunks; // edited since the last upload
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "ray_benchmark.hpp"
+
+uint32_t xorshift(uint32_t &seed)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+float randomFloat(uint32_t &seed)
+{
+    return (xorshift(seed) & 0xffffff) / (float)0x1000000;
+}
+
+glm::vec3 randomRayOrigin(uint32_t &seed, glm::vec3 centre, float radius)
+{
+    glm::vec3 t_out = glm::vec3(randomFloat(seed), randomFloat(seed), randomFloat(seed)) * 2.f - glm::vec3(1.f);
+    if (glm::length(t_out) == 0.f)
+        t_out = glm::vec3(1.f, 0.f, 0.f);
+    return centre + glm::normalize(t_out) * radius;
+}
+
+BenchmarkRays makeBenchmarkRays(uint32_t &seed, uint32_t count, float size)
+{
+    BenchmarkRays rays;
+    rays.origins.resize(count);
+    rays.dirs.resize(count);
+    glm::vec3 t_centre = glm::vec3(size / 2.f);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        rays.origins[i] = randomRayOrigin(seed, t_centre, size);
+        glm::vec3 t_target = glm::vec3(randomFloat(seed), randomFloat(seed), randomFloat(seed)) * size;
+        rays.dirs[i] = t_target - rays.origins[i];
+    }
+    return rays;
+}
@@ -0,0 +1,28 @@
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#ifndef RAY_BENCHMARK_HPP
+#define RAY_BENCHMARK_HPP
+
+// Seeded random numbers and rays shared by the benchmarks, the same seed
+// gives the same scene and rays on every run
+
+struct BenchmarkRays
+{
+  std::vector<glm::vec3> origins;
+  std::vector<glm::vec3> dirs; // towards the target, not normalised
+};
+
+uint32_t xorshift(uint32_t &seed);
+// in [0, 1)
+float randomFloat(uint32_t &seed);
+
+// a point on the sphere of the given radius around centre
+glm::vec3 randomRayOrigin(uint32_t &seed, glm::vec3 centre, float radius);
+
+// count rays from a sphere of radius size around the grid [0, size)^3
+// towards random points inside it
+BenchmarkRays makeBenchmarkRays(uint32_t &seed, uint32_t count, float size);
+
+#endif
@@ -0,0 +1,256 @@
+#include "ray_box.hpp"
+#include "ray_benchmark.hpp"
+#include "../items/simd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+#define RAY_BOX_BENCHMARK_SIZE 64
+#define RAY_BOX_BENCHMARK_VOXELS 4096
+#define RAY_BOX_BENCHMARK_RAYS 20000
+
+void AabbList::Add(glm::vec3 min, glm::vec3 max)
+{
+    minX.push_back(min.x);
+    minY.push_back(min.y);
+    minZ.push_back(min.z);
+    maxX.push_back(max.x);
+    maxY.push_back(max.y);
+    maxZ.push_back(max.z);
+}
+
+void AabbList::Clear()
+{
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+}
+
+size_t AabbList::Size() const
+{
+    return minX.size();
+}
+
+RaySlab makeRaySlab(glm::vec3 origin, glm::vec3 dir)
+{
+    RaySlab ray;
+    float length = glm::length(dir);
+    ray.origin = origin;
+    ray.dir = length == 0.f ? glm::vec3(0.f) : dir / length;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (ray.dir[axis] == 0.f)
+            ray.invDir[axis] = RAY_BOX_INFINITE_INV;
+        else
+            ray.invDir[axis] = 1.f / ray.dir[axis];
+    }
+    return ray;
+}
+
+// same operations in the same order as the vector paths, so the results
+// are bit for bit equal
+static inline float slabScalar(const RaySlab &ray, const AabbList &boxes, size_t i, float maxDistance)
+{
+    float t1x = (boxes.minX[i] - ray.origin.x) * ray.invDir.x;
+    float t2x = (boxes.maxX[i] - ray.origin.x) * ray.invDir.x;
+    float t1y = (boxes.minY[i] - ray.origin.y) * ray.invDir.y;
+    float t2y = (boxes.maxY[i] - ray.origin.y) * ray.invDir.y;
+    float t1z = (boxes.minZ[i] - ray.origin.z) * ray.invDir.z;
+    float t2z = (boxes.maxZ[i] - ray.origin.z) * ray.invDir.z;
+    float tNear = std::max(std::max(std::min(t1x, t2x), std::min(t1y, t2y)), std::min(t1z, t2z));
+    float tFar = std::min(std::min(std::max(t1x, t2x), std::max(t1y, t2y)), std::max(t1z, t2z));
+    float tEnter = std::max(tNear, 0.f);
+    return (tEnter <= tFar && tEnter <= maxDistance) ? tEnter : std::numeric_limits<float>::infinity();
+}
+
+#if defined(SIMD_AVX2)
+static inline __m256 slab8(const RaySlab &ray, const AabbList &boxes, size_t i, __m256 maxDistance)
+{
+    __m256 ox = _mm256_set1_ps(ray.origin.x), oy = _mm256_set1_ps(ray.origin.y), oz = _mm256_set1_ps(ray.origin.z);
+    __m256 ix = _mm256_set1_ps(ray.invDir.x), iy = _mm256_set1_ps(ray.invDir.y), iz = _mm256_set1_ps(ray.invDir.z);
+    __m256 t1x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.minX[i]), ox), ix);
+    __m256 t2x = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.maxX[i]), ox), ix);
+    __m256 t1y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.minY[i]), oy), iy);
+    __m256 t2y = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.maxY[i]), oy), iy);
+    __m256 t1z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.minZ[i]), oz), iz);
+    __m256 t2z = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&boxes.maxZ[i]), oz), iz);
+    __m256 tNear = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t1x, t2x), _mm256_min_ps(t1y, t2y)), _mm256_min_ps(t1z, t2z));
+    __m256 tFar = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t1x, t2x), _mm256_max_ps(t1y, t2y)), _mm256_max_ps(t1z, t2z));
+    __m256 tEnter = _mm256_max_ps(tNear, _mm256_setzero_ps());
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tEnter, tFar, _CMP_LE_OQ), _mm256_cmp_ps(tEnter, maxDistance, _CMP_LE_OQ));
+    return _mm256_blendv_ps(_mm256_set1_ps(std::numeric_limits<float>::infinity()), tEnter, hit);
+}
+
+static inline void testBlock(const RaySlab &ray, const AabbList &boxes, size_t i, float maxDistance, float *tEnter)
+{
+    __m256 t_max = _mm256_set1_ps(maxDistance);
+    _mm256_storeu_ps(tEnter, slab8(ray, boxes, i, t_max));
+    _mm256_storeu_ps(tEnter + 8, slab8(ray, boxes, i + 8, t_max));
+}
+#elif defined(SIMD_SSE2)
+static inline __m128 slab4(const RaySlab &ray, const AabbList &boxes, size_t i, __m128 maxDistance)
+{
+    __m128 ox = _mm_set1_ps(ray.origin.x), oy = _mm_set1_ps(ray.origin.y), oz = _mm_set1_ps(ray.origin.z);
+    __m128 ix = _mm_set1_ps(ray.invDir.x), iy = _mm_set1_ps(ray.invDir.y), iz = _mm_set1_ps(ray.invDir.z);
+    __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.minX[i]), ox), ix);
+    __m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.maxX[i]), ox), ix);
+    __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.minY[i]), oy), iy);
+    __m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.maxY[i]), oy), iy);
+    __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.minZ[i]), oz), iz);
+    __m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&boxes.maxZ[i]), oz), iz);
+    __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_min_ps(t1z, t2z));
+    __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_max_ps(t1z, t2z));
+    __m128 tEnter = _mm_max_ps(tNear, _mm_setzero_ps());
+    // SSE2 has no blend, select with and/andnot
+    __m128 hit = _mm_and_ps(_mm_cmple_ps(tEnter, tFar), _mm_cmple_ps(tEnter, maxDistance));
+    __m128 miss = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    return _mm_or_ps(_mm_and_ps(hit, tEnter), _mm_andnot_ps(hit, miss));
+}
+
+static inline void testBlock(const RaySlab &ray, const AabbList &boxes, size_t i, float maxDistance, float *tEnter)
+{
+    __m128 t_max = _mm_set1_ps(maxDistance);
+    for (int k = 0; k < RAY_BOX_BLOCK; k += 4)
+        _mm_storeu_ps(tEnter + k, slab4(ray, boxes, i + k, t_max));
+}
+#else
+static inline void testBlock(const RaySlab &ray, const AabbList &boxes, size_t i, float maxDistance, float *tEnter)
+{
+    for (int k = 0; k < RAY_BOX_BLOCK; k++)
+        tEnter[k] = slabScalar(ray, boxes, i + k, maxDistance);
+}
+#endif
+
+void intersectBoxes(const RaySlab &ray, const AabbList &boxes, float maxDistance, float *tEnter)
+{
+    size_t t_count = boxes.Size();
+    size_t i = 0;
+    for (; i + RAY_BOX_BLOCK <= t_count; i += RAY_BOX_BLOCK)
+        testBlock(ray, boxes, i, maxDistance, tEnter + i);
+    for (; i < t_count; i++)
+        tEnter[i] = slabScalar(ray, boxes, i, maxDistance);
+}
+
+void intersectBoxesScalar(const RaySlab &ray, const AabbList &boxes, float maxDistance, float *tEnter)
+{
+    size_t t_count = boxes.Size();
+    for (size_t i = 0; i < t_count; i++)
+        tEnter[i] = slabScalar(ray, boxes, i, maxDistance);
+}
+
+int nearestBox(const RaySlab &ray, const AabbList &boxes, float maxDistance, float &distance, glm::ivec3 &normal)
+{
+    int result = -1;
+    distance = maxDistance;
+    size_t t_count = boxes.Size();
+    float t_block[RAY_BOX_BLOCK];
+    for (size_t i = 0; i < t_count; i += RAY_BOX_BLOCK)
+    {
+        size_t t_size = std::min((size_t)RAY_BOX_BLOCK, t_count - i);
+        if (t_size == RAY_BOX_BLOCK)
+            testBlock(ray, boxes, i, distance, t_block);
+        else
+            for (size_t k = 0; k < t_size; k++)
+                t_block[k] = slabScalar(ray, boxes, i + k, distance);
+        // strictly nearer only, so the first of equal boxes wins
+        for (size_t k = 0; k < t_size; k++)
+            if (t_block[k] < distance || (result < 0 && t_block[k] == distance))
+            {
+                distance = t_block[k];
+                result = (int)(i + k);
+            }
+    }
+    if (result < 0)
+    {
+        distance = 0.f;
+        return result;
+    }
+
+    // entry axis of the winner, zero when the ray starts inside it
+    normal = glm::ivec3(0);
+    glm::vec3 t1 = (glm::vec3(boxes.minX[result], boxes.minY[result], boxes.minZ[result]) - ray.origin) * ray.invDir;
+    glm::vec3 t2 = (glm::vec3(boxes.maxX[result], boxes.maxY[result], boxes.maxZ[result]) - ray.origin) * ray.invDir;
+    glm::vec3 tNear = glm::min(t1, t2);
+    float tEnter = std::max(std::max(tNear.x, tNear.y), tNear.z);
+    if (tEnter >= 0.f)
+    {
+        int axis = tEnter == tNear.x ? 0 : (tEnter == tNear.y ? 1 : 2);
+        normal[axis] = ray.dir[axis] > 0.f ? -1 : 1;
+    }
+    return result;
+}
+
+const char *getRayBoxPath()
+{
+    return SIMD_PATH;
+}
+
+// random voxels of a 64^3 grid, each its own box, and rays from a sphere
+// around the grid towards random points inside it
+static BenchmarkRays makeBoxScene(std::vector<Voxel> &voxels, AabbList &boxes)
+{
+    uint32_t t_seed = 2463534242u;
+    for (int i = 0; i < RAY_BOX_BENCHMARK_VOXELS; i++)
+    {
+        glm::ivec3 t_pos = glm::ivec3(xorshift(t_seed) % RAY_BOX_BENCHMARK_SIZE, xorshift(t_seed) % RAY_BOX_BENCHMARK_SIZE,
+                                      xorshift(t_seed) % RAY_BOX_BENCHMARK_SIZE);
+        voxels.push_back({glm::i16vec3(t_pos), 0});
+        boxes.Add(glm::vec3(t_pos) - glm::vec3(0.5f), glm::vec3(t_pos) + glm::vec3(0.5f));
+    }
+    return makeBenchmarkRays(t_seed, RAY_BOX_BENCHMARK_RAYS, (float)RAY_BOX_BENCHMARK_SIZE);
+}
+
+// every distance of each 16th ray, and the nearest hit of every ray
+static void countRayBoxErrors(const std::vector<Voxel> &voxels, const AabbList &boxes, const BenchmarkRays &rays,
+                              float range, uint32_t &distanceErrors, uint32_t &hitErrors)
+{
+    std::vector<float> t_scalar(boxes.Size()), t_simd(boxes.Size());
+    for (uint32_t i = 0; i < rays.origins.size(); i++)
+    {
+        RaySlab t_ray = makeRaySlab(rays.origins[i], rays.dirs[i]);
+        if (i % 16 == 0)
+        {
+            intersectBoxesScalar(t_ray, boxes, range, t_scalar.data());
+            intersectBoxes(t_ray, boxes, range, t_simd.data());
+            for (size_t k = 0; k < t_scalar.size(); k++)
+                if (t_scalar[k] != t_simd[k])
+                    distanceErrors++;
+        }
+        float t_distance;
+        glm::ivec3 t_normal;
+        int t_box = nearestBox(t_ray, boxes, range, t_distance, t_normal);
+        RayHit t_reference = castRayBruteForce(voxels, rays.origins[i], rays.dirs[i], range);
+        if (t_reference.hit != (t_box >= 0) ||
+            (t_reference.hit && (t_reference.cell != glm::ivec3(voxels[t_box].pos) || t_reference.normal != t_normal)))
+            hitErrors++;
+    }
+}
+
+RayBoxBenchmark benchmarkRayBoxes()
+{
+    RayBoxBenchmark result = {SIMD_PATH, 0, RAY_BOX_BENCHMARK_RAYS, 0.f, 0.f, 0, 0};
+    std::vector<Voxel> t_voxels;
+    AabbList t_boxes;
+    BenchmarkRays t_rays = makeBoxScene(t_voxels, t_boxes);
+    result.boxes = (uint32_t)t_boxes.Size();
+
+    float t_range = RAY_BOX_BENCHMARK_SIZE * 3.f;
+    std::vector<float> t_scalar(t_boxes.Size()), t_simd(t_boxes.Size());
+    float t_tests = (float)t_boxes.Size() * RAY_BOX_BENCHMARK_RAYS;
+    auto t_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < RAY_BOX_BENCHMARK_RAYS; i++)
+        intersectBoxesScalar(makeRaySlab(t_rays.origins[i], t_rays.dirs[i]), t_boxes, t_range, t_scalar.data());
+    result.scalarRate = t_tests / std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t_start).count();
+
+    t_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < RAY_BOX_BENCHMARK_RAYS; i++)
+        intersectBoxes(makeRaySlab(t_rays.origins[i], t_rays.dirs[i]), t_boxes, t_range, t_simd.data());
+    result.simdRate = t_tests / std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t_start).count();
+
+    countRayBoxErrors(t_voxels, t_boxes, t_rays, t_range, result.distanceErrors, result.hitErrors);
+    return result;
+}
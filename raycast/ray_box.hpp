@@ -0,0 +1,69 @@
+#include "raycast.hpp"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef RAY_BOX_HPP
+#define RAY_BOX_HPP
+
+// boxes tested per step of the kernel: two AVX2 or four SSE registers
+#define RAY_BOX_BLOCK 16
+// stands in for 1 / 0 so slabs parallel to the ray never produce 0 * inf
+#define RAY_BOX_INFINITE_INV 1e30f
+
+// Axis aligned boxes as separate arrays of min and max corners, so a block
+// of boxes loads into one register per coordinate
+struct AabbList
+{
+  std::vector<float> minX, minY, minZ;
+  std::vector<float> maxX, maxY, maxZ;
+
+  void Add(glm::vec3 min, glm::vec3 max);
+  void Clear();
+  size_t Size() const;
+};
+
+// A normalised ray with its reciprocal direction, built once per ray
+struct RaySlab
+{
+  glm::vec3 origin;
+  glm::vec3 dir;
+  glm::vec3 invDir;
+};
+
+struct RayBoxBenchmark
+{
+  const char *path; // "AVX2", "SSE2" or "scalar", picked at compile time
+  uint32_t boxes;
+  uint32_t rays;
+  float scalarRate;        // million ray-box tests per second
+  float simdRate;          // million ray-box tests per second
+  uint32_t distanceErrors; // boxes where the kernel and the scalar loop disagree
+  uint32_t hitErrors;      // rays where nearestBox and castRayBruteForce disagree
+};
+
+RaySlab makeRaySlab(glm::vec3 origin, glm::vec3 dir);
+
+// tEnter[i] is where the ray enters box i, 0 when it starts inside, or
+// infinity when it misses the box or enters it past maxDistance. The
+// kernel runs RAY_BOX_BLOCK boxes at a time with AVX2 when compiled with
+// -mavx2 (/arch:AVX2, the VOXEL_AVX2 CMake option), SSE2 on any other
+// x86-64 build and plain C++ elsewhere; the scalar version is the
+// reference it must match exactly.
+void intersectBoxes(const RaySlab &ray, const AabbList &boxes, float maxDistance, float *tEnter);
+void intersectBoxesScalar(const RaySlab &ray, const AabbList &boxes, float maxDistance, float *tEnter);
+
+// Index of the first box with the nearest entry, -1 when nothing is hit;
+// distance and normal follow castRayBruteForce
+int nearestBox(const RaySlab &ray, const AabbList &boxes, float maxDistance, float &distance, glm::ivec3 &normal);
+
+// name of the compiled kernel path
+const char *getRayBoxPath();
+
+// Rays against the boxes of a few thousand voxels with both loops, and the
+// nearest hits against castRayBruteForce
+RayBoxBenchmark benchmarkRayBoxes();
+
+#endif
@@ -0,0 +1,137 @@
+#include "raycast.hpp"
+#include "ray_benchmark.hpp"
+
+#include <chrono>
+#include <limits>
+
+// Distance to the face the ray leaves cell through. It is recomputed from
+// the cell on every step instead of adding up 1 / dir, so it is exactly the
+// slab distance castRayBruteForce gets and does not drift on long rays
+static inline float nextBoundary(int cell, int step, float origin, float invDir)
+{
+    return ((float)(cell + (step > 0 ? 1 : 0)) - 0.5f - origin) * invDir;
+}
+
+RayHit castRay(const ChunkMap &occupancy, glm::vec3 origin, glm::vec3 dir, float maxDistance)
+{
+    RayHit hit = {false, glm::ivec3(0), glm::ivec3(0), 0.f};
+    float length = glm::length(dir);
+    if (length == 0.f)
+        return hit;
+    dir /= length;
+
+    // cell i covers [i - 0.5, i + 0.5)
+    glm::ivec3 cell = glm::ivec3(glm::floor(origin + glm::vec3(0.5f)));
+    glm::ivec3 step = glm::ivec3(0);
+    glm::vec3 invDir = 1.f / dir;
+    glm::vec3 tMax = glm::vec3(std::numeric_limits<float>::infinity());
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (dir[axis] > 0.f)
+            step[axis] = 1;
+        else if (dir[axis] < 0.f)
+            step[axis] = -1;
+        if (step[axis] != 0)
+            tMax[axis] = nextBoundary(cell[axis], step[axis], origin[axis], invDir[axis]);
+    }
+
+    glm::ivec3 normal = glm::ivec3(0);
+    float t = 0.f;
+    while (t <= maxDistance)
+    {
+        if (occupancy.Get(cell))
+        {
+            hit = {true, cell, normal, t};
+            return hit;
+        }
+        int axis = tMax.x < tMax.y ? (tMax.x < tMax.z ? 0 : 2) : (tMax.y < tMax.z ? 1 : 2);
+        t = tMax[axis];
+        cell[axis] += step[axis];
+        tMax[axis] = nextBoundary(cell[axis], step[axis], origin[axis], invDir[axis]);
+        normal = glm::ivec3(0);
+        normal[axis] = -step[axis];
+    }
+    return hit;
+}
+
+RayHit castRayBruteForce(const std::vector<Voxel> &voxels, glm::vec3 origin, glm::vec3 dir, float maxDistance)
+{
+    RayHit hit = {false, glm::ivec3(0), glm::ivec3(0), maxDistance};
+    float length = glm::length(dir);
+    if (length == 0.f)
+        return hit;
+    dir /= length;
+    glm::vec3 invDir = 1.f / dir;
+
+    for (const Voxel &voxel : voxels)
+    {
+        glm::vec3 t1 = (glm::vec3(voxel.pos) - glm::vec3(0.5f) - origin) * invDir;
+        glm::vec3 t2 = (glm::vec3(voxel.pos) + glm::vec3(0.5f) - origin) * invDir;
+        glm::vec3 tNear = glm::min(t1, t2);
+        glm::vec3 tFar = glm::max(t1, t2);
+        float tEnter = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+        float tExit = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+        if (tEnter > tExit || tExit < 0.f)
+            continue;
+
+        glm::ivec3 normal = glm::ivec3(0);
+        if (tEnter < 0.f)
+            tEnter = 0.f;
+        else
+        {
+            int axis = tEnter == tNear.x ? 0 : (tEnter == tNear.y ? 1 : 2);
+            normal[axis] = dir[axis] > 0.f ? -1 : 1;
+        }
+        if (tEnter > hit.distance || (hit.hit && tEnter == hit.distance))
+            continue;
+        hit = {true, glm::ivec3(voxel.pos), normal, tEnter};
+    }
+    return hit;
+}
+
+RaycastBenchmark benchmarkRaycast()
+{
+    const int t_size = 200;
+    const uint32_t t_ddaRays = 10000;
+    const uint32_t t_bruteForceRays = 100;
+
+    RaycastBenchmark result = {0, t_bruteForceRays, 0, 0.f, 0.f};
+
+    // every eighth cell of a 200^3 grid is solid
+    ChunkMap t_occupancy;
+    std::vector<Voxel> t_voxels;
+    uint32_t t_seed = 2463534242u;
+    for (int x = 0; x < t_size; x++)
+        for (int y = 0; y < t_size; y++)
+            for (int z = 0; z < t_size; z++)
+            {
+                if (xorshift(t_seed) & 7)
+                    continue;
+                Voxel t_voxel = {glm::i16vec3(x, y, z), 0};
+                t_voxels.push_back(t_voxel);
+                t_occupancy.Set(glm::ivec3(x, y, z), true);
+            }
+    result.voxelCount = (uint32_t)t_voxels.size();
+
+    // rays from a sphere around the grid towards random points inside it
+    BenchmarkRays t_rays = makeBenchmarkRays(t_seed, t_ddaRays, (float)t_size);
+
+    float t_range = t_size * 3.f;
+    std::vector<RayHit> t_hits(t_ddaRays);
+    auto t_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < t_ddaRays; i++)
+        t_hits[i] = castRay(t_occupancy, t_rays.origins[i], t_rays.dirs[i], t_range);
+    result.ddaTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count() / t_ddaRays;
+
+    t_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < t_bruteForceRays; i++)
+    {
+        RayHit t_reference = castRayBruteForce(t_voxels, t_rays.origins[i], t_rays.dirs[i], t_range);
+        if (t_reference.hit != t_hits[i].hit ||
+            (t_reference.hit && (t_reference.cell != t_hits[i].cell || t_reference.normal != t_hits[i].normal)))
+            result.mismatches++;
+    }
+    result.bruteForceTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count() / t_bruteForceRays;
+
+    return result;
+}
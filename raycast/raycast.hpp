@@ -0,0 +1,38 @@
+#include "../items/items.hpp"
+#include "../chunk/chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#ifndef RAYCAST_HPP
+#define RAYCAST_HPP
+
+struct RayHit
+{
+  bool hit;
+  glm::ivec3 cell;   // position of the hit voxel
+  glm::ivec3 normal; // face the ray entered through, zero if it started inside
+  float distance;    // along the normalised ray
+};
+
+struct RaycastBenchmark
+{
+  uint32_t voxelCount;
+  uint32_t rays;
+  uint32_t mismatches;  // rays where both casts disagree on the hit voxel
+  float ddaTime;        // ms per ray
+  float bruteForceTime; // ms per ray
+};
+
+// Walks the cells along the ray (Amanatides & Woo) and returns the first
+// solid one, voxel centres sit on integer coordinates
+RayHit castRay(const ChunkMap &occupancy, glm::vec3 origin, glm::vec3 dir, float maxDistance);
+
+// Reference cast, slab test against every voxel keeping the nearest entry
+RayHit castRayBruteForce(const std::vector<Voxel> &voxels, glm::vec3 origin, glm::vec3 dir, float maxDistance);
+
+// Casts random rays into roughly a million voxels with both functions
+RaycastBenchmark benchmarkRaycast();
+
+#endif
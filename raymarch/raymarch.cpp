@@ -0,0 +1,231 @@
+#include "raymarch.hpp"
+
+#include <chrono>
+
+static RayMarchUniforms getRayMarchUniforms(const Shader &shader)
+{
+    RayMarchUniforms t_uniforms;
+    t_uniforms.viewPos = shader.GetUniform("viewPos");
+    t_uniforms.lightDirection = shader.GetUniform("light.direction");
+    t_uniforms.lightAmbient = shader.GetUniform("light.ambient");
+    t_uniforms.lightDiffuse = shader.GetUniform("light.diffuse");
+    t_uniforms.lightSpecular = shader.GetUniform("light.specular");
+    t_uniforms.projection = shader.GetUniform("projection");
+    t_uniforms.view = shader.GetUniform("view");
+    t_uniforms.model = shader.GetUniform("model");
+    t_uniforms.inverseMvp = shader.GetUniform("inverseMvp");
+    t_uniforms.volume = shader.GetUniform("volume");
+    t_uniforms.bricks = shader.GetUniform("bricks");
+    t_uniforms.materials = shader.GetUniform("materials");
+    t_uniforms.volumeOrigin = shader.GetUniform("volumeOrigin");
+    t_uniforms.volumeSize = shader.GetUniform("volumeSize");
+    return t_uniforms;
+}
+
+static std::string getRayMarchDefines()
+{
+    return "#define BRICK_SIZE " + std::to_string(RAYMARCH_BRICK_SIZE) + "\n";
+}
+
+VolumeRenderer::VolumeRenderer()
+{
+    m_VAO = 0;
+    m_volumeTexture = 0;
+    m_brickTexture = 0;
+    m_origin = glm::ivec3(0);
+    m_stats = {glm::ivec3(0), 0, 0.f, false};
+}
+
+void VolumeRenderer::Init()
+{
+    m_shader.Init("raymarch", "raymarch", getRayMarchDefines());
+    m_uniforms = getRayMarchUniforms(m_shader);
+    glGenVertexArrays(1, &m_VAO);
+
+    glGenTextures(1, &m_volumeTexture);
+    glGenTextures(1, &m_brickTexture);
+    for (uint32_t texture : {m_volumeTexture, m_brickTexture})
+    {
+        glBindTexture(GL_TEXTURE_3D, texture);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void VolumeRenderer::Destroy()
+{
+    glDeleteVertexArrays(1, &m_VAO);
+    glDeleteTextures(1, &m_volumeTexture);
+    glDeleteTextures(1, &m_brickTexture);
+    m_VAO = 0;
+    m_volumeTexture = 0;
+    m_brickTexture = 0;
+    m_stats = {glm::ivec3(0), 0, 0.f, false};
+}
+
+// rounds towards negative infinity to a multiple of the brick size
+static glm::ivec3 alignToBrick(glm::ivec3 pos)
+{
+    glm::ivec3 t_rest = ((pos % RAYMARCH_BRICK_SIZE) + RAYMARCH_BRICK_SIZE) % RAYMARCH_BRICK_SIZE;
+    return pos - t_rest;
+}
+
+// Fills the material + 1 of each voxel inside the box into cells, 0 stays
+// empty, x varying fastest as GL expects; a brick texel is 1 when any of
+// its cells is set. min is brick aligned.
+static void fillCells(glm::ivec3 min, glm::ivec3 size, const std::vector<Voxel> &voxels,
+                      std::vector<MaterialID> &cells, std::vector<uint8_t> &occupied)
+{
+    glm::ivec3 t_bricks = (size + glm::ivec3(RAYMARCH_BRICK_SIZE - 1)) / RAYMARCH_BRICK_SIZE;
+    cells.assign((size_t)size.x * size.y * size.z, 0);
+    occupied.assign((size_t)t_bricks.x * t_bricks.y * t_bricks.z, 0);
+    for (const Voxel &voxel : voxels)
+    {
+        glm::ivec3 t_cell = glm::ivec3(voxel.pos) - min;
+        if (glm::any(glm::lessThan(t_cell, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(t_cell, size)))
+            continue;
+        cells[((size_t)t_cell.z * size.y + t_cell.y) * size.x + t_cell.x] = voxel.mat + 1;
+        glm::ivec3 t_brick = t_cell / RAYMARCH_BRICK_SIZE;
+        occupied[((size_t)t_brick.z * t_bricks.y + t_brick.y) * t_bricks.x + t_brick.x] = 1;
+    }
+}
+
+// The volume starts on a brick boundary so any brick aligned box, like a
+// chunk, covers whole bricks and can be rewritten on its own
+void VolumeRenderer::Upload(const std::vector<Voxel> &voxels)
+{
+    auto t_start = std::chrono::steady_clock::now();
+    m_stats = {glm::ivec3(0), 0, 0.f, false};
+    if (voxels.empty())
+        return;
+
+    glm::ivec3 t_min = glm::ivec3(voxels.front().pos);
+    glm::ivec3 t_max = t_min;
+    for (const Voxel &voxel : voxels)
+    {
+        t_min = glm::min(t_min, glm::ivec3(voxel.pos));
+        t_max = glm::max(t_max, glm::ivec3(voxel.pos));
+    }
+    t_min = alignToBrick(t_min);
+    glm::ivec3 t_size = t_max - t_min + glm::ivec3(1);
+    GLint t_maxTexture = 0;
+    glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &t_maxTexture);
+    if ((uint64_t)t_size.x * t_size.y * t_size.z > RAYMARCH_MAX_CELLS ||
+        glm::any(glm::greaterThan(t_size, glm::ivec3(t_maxTexture))))
+    {
+        std::cout << "RAYMARCH::UPLOAD::VOLUME_TOO_LARGE" << std::endl;
+        m_stats.tooLarge = true;
+        return;
+    }
+
+    std::vector<MaterialID> t_cells;
+    std::vector<uint8_t> t_occupied;
+    fillCells(t_min, t_size, voxels, t_cells, t_occupied);
+    glm::ivec3 t_bricks = (t_size + glm::ivec3(RAYMARCH_BRICK_SIZE - 1)) / RAYMARCH_BRICK_SIZE;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_3D, m_volumeTexture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R16UI, t_size.x, t_size.y, t_size.z, 0,
+                 GL_RED_INTEGER, GL_UNSIGNED_SHORT, t_cells.data());
+    glBindTexture(GL_TEXTURE_3D, m_brickTexture);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8UI, t_bricks.x, t_bricks.y, t_bricks.z, 0,
+                 GL_RED_INTEGER, GL_UNSIGNED_BYTE, t_occupied.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    m_origin = t_min;
+    m_stats.size = t_size;
+    m_stats.bytes = t_cells.size() * sizeof(MaterialID) + t_occupied.size();
+    m_stats.uploadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+}
+
+// The box is clipped to the volume; both start on brick boundaries, so the
+// clipped box still covers whole bricks, only the last one along an axis
+// may be cut off by the end of the volume like in the full upload
+bool VolumeRenderer::UploadBox(glm::ivec3 min, glm::ivec3 size, const std::vector<Voxel> &voxels)
+{
+    if (!m_stats.size.x)
+        return false;
+    auto t_start = std::chrono::steady_clock::now();
+    glm::ivec3 t_end = m_origin + m_stats.size;
+    for (const Voxel &voxel : voxels)
+        if (glm::any(glm::lessThan(glm::ivec3(voxel.pos), m_origin)) ||
+            glm::any(glm::greaterThanEqual(glm::ivec3(voxel.pos), t_end)))
+            return false;
+
+    glm::ivec3 t_min = glm::max(min, m_origin);
+    glm::ivec3 t_size = glm::min(min + size, t_end) - t_min;
+    if (glm::any(glm::lessThanEqual(t_size, glm::ivec3(0))))
+        return true;
+
+    std::vector<MaterialID> t_cells;
+    std::vector<uint8_t> t_occupied;
+    fillCells(t_min, t_size, voxels, t_cells, t_occupied);
+    glm::ivec3 t_cell = t_min - m_origin;
+    glm::ivec3 t_brick = t_cell / RAYMARCH_BRICK_SIZE;
+    glm::ivec3 t_bricks = (t_size + glm::ivec3(RAYMARCH_BRICK_SIZE - 1)) / RAYMARCH_BRICK_SIZE;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_3D, m_volumeTexture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, t_cell.x, t_cell.y, t_cell.z, t_size.x, t_size.y, t_size.z,
+                    GL_RED_INTEGER, GL_UNSIGNED_SHORT, t_cells.data());
+    glBindTexture(GL_TEXTURE_3D, m_brickTexture);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, t_brick.x, t_brick.y, t_brick.z, t_bricks.x, t_bricks.y, t_bricks.z,
+                    GL_RED_INTEGER, GL_UNSIGNED_BYTE, t_occupied.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    m_stats.uploadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    return true;
+}
+
+void VolumeRenderer::Draw(MVP mvp, glm::vec3 cameraPosition, Light light, uint32_t paletteTexture)
+{
+    if (!m_stats.size.x)
+        return;
+    m_shader.Use();
+    m_shader.SetVec3(m_uniforms.viewPos, cameraPosition);
+    m_shader.SetVec3(m_uniforms.lightDirection, light.direction);
+    m_shader.SetVec3(m_uniforms.lightAmbient, light.ambient);
+    m_shader.SetVec3(m_uniforms.lightDiffuse, light.diffuse);
+    m_shader.SetVec3(m_uniforms.lightSpecular, light.specular);
+    m_shader.SetMat4(m_uniforms.projection, mvp.projection);
+    m_shader.SetMat4(m_uniforms.view, mvp.view);
+    m_shader.SetMat4(m_uniforms.model, mvp.model);
+    m_shader.SetMat4(m_uniforms.inverseMvp, glm::inverse(mvp.projection * mvp.view * mvp.model));
+    m_shader.SetIVec3(m_uniforms.volumeOrigin, m_origin);
+    m_shader.SetIVec3(m_uniforms.volumeSize, m_stats.size);
+    m_shader.SetInt(m_uniforms.materials, 0);
+    m_shader.SetInt(m_uniforms.volume, 1);
+    m_shader.SetInt(m_uniforms.bricks, 2);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, m_volumeTexture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, m_brickTexture);
+
+    // wireframe has no meaning for the fullscreen triangle
+    GLint t_polygonMode[2];
+    glGetIntegerv(GL_POLYGON_MODE, t_polygonMode);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glBindVertexArray(m_VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glPolygonMode(GL_FRONT_AND_BACK, (GLenum)t_polygonMode[0]);
+
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+VolumeStats VolumeRenderer::GetStats() const
+{
+    return m_stats;
+}
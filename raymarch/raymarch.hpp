@@ -0,0 +1,108 @@
+#include "../shader/shader.hpp"
+#include "../items/items.hpp"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef RAYMARCH_HPP
+#define RAYMARCH_HPP
+
+// cells per axis of one brick of the occupancy grid, empty bricks are
+// skipped in one step
+#define RAYMARCH_BRICK_SIZE 8
+// larger objects are not uploaded and are drawn by the raster path instead,
+// 256 MB of material IDs
+#define RAYMARCH_MAX_CELLS (512u * 512u * 512u)
+
+struct VolumeStats
+{
+  glm::ivec3 size;  // cells per axis, 0 when nothing is uploaded
+  size_t bytes;     // volume and brick textures
+  float uploadTime; // ms, of the last full or partial upload
+  bool tooLarge;    // the last full upload was refused
+};
+
+struct RayMarchScene
+{
+  uint32_t voxelCount;
+  uint32_t triangles; // drawn by the raster path
+  size_t meshBytes;   // vertex and index buffers of the raster path
+  size_t volumeBytes;
+  float rasterTime;            // ms per frame
+  float rayMarchTime;          // ms per frame
+  uint32_t coveredPixels;      // by the raster path
+  uint32_t coverageMismatches; // pixels only one path drew
+  uint32_t interiorMismatches; // of those, pixels off the silhouettes of both frames
+  uint32_t colorMismatches;    // pixels both drew in visibly different colours
+};
+
+struct RayMarchBenchmark
+{
+  RayMarchScene ball;  // solid ball, little surface per voxel
+  RayMarchScene noise; // random half filled block, mostly surface
+};
+
+// uniforms of raymarch.vert/raymarch.frag, resolved once after linking
+struct RayMarchUniforms
+{
+  Uniform viewPos;
+  Uniform lightDirection;
+  Uniform lightAmbient;
+  Uniform lightDiffuse;
+  Uniform lightSpecular;
+  Uniform projection;
+  Uniform view;
+  Uniform model;
+  Uniform inverseMvp;
+  Uniform volume;
+  Uniform bricks;
+  Uniform materials;
+  Uniform volumeOrigin;
+  Uniform volumeSize;
+};
+
+// Draws voxels without meshes: the material IDs of the object's bounding
+// box go into a 3D texture and one fullscreen triangle DDA-marches it per
+// pixel, shading the hit with the same Light and palette as basic.frag.
+// Depth is written, so raster passes drawn afterwards still sort with it.
+class VolumeRenderer
+{
+public:
+  VolumeRenderer();
+
+  // needs a current GL context
+  void Init();
+  void Destroy();
+  void Upload(const std::vector<Voxel> &voxels);
+  // rewrites the cells of one brick aligned box, e.g. an edited chunk, from
+  // the voxels inside it; false when a voxel lies outside the uploaded
+  // volume and everything has to be uploaded again
+  bool UploadBox(glm::ivec3 min, glm::ivec3 size, const std::vector<Voxel> &voxels);
+  // the palette is the buffer texture filled by Object::updatePalette
+  void Draw(MVP mvp, glm::vec3 cameraPosition, Light light, uint32_t paletteTexture);
+  VolumeStats GetStats() const;
+
+private:
+  Shader m_shader;
+  RayMarchUniforms m_uniforms;
+  uint32_t m_VAO; // no attributes, the vertex shader builds the triangle
+  uint32_t m_volumeTexture;
+  uint32_t m_brickTexture;
+  glm::ivec3 m_origin; // object space voxel of cell 0, brick aligned
+  VolumeStats m_stats;
+};
+
+// sizes of the editor's benchmark, ~1M voxels each
+#define RAYMARCH_BENCHMARK_RADIUS 62
+#define RAYMARCH_BENCHMARK_BLOCK 126
+#define RAYMARCH_BENCHMARK_FRAMES 8
+
+// Raster against ray marched frames of a ball of the given radius and a
+// random half filled 2 x 1 x 1/2 blockSize block, rendered offscreen and
+// timed over frames frames; the raster path draws greedy meshes without
+// ambient occlusion so the two images can be compared pixel by pixel
+RayMarchBenchmark benchmarkRayMarching(int radius, int blockSize, int frames);
+
+#endif
@@ -0,0 +1,259 @@
+#include "raymarch.hpp"
+#include "../chunk/chunk.hpp"
+#include "../material/material.hpp"
+#include "../mesher/mesher.hpp"
+#include "../mesher/vertex_layout.hpp"
+#include "../raycast/ray_benchmark.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+
+// channel difference out of 255 still counted as the same colour
+#define RAYMARCH_COLOR_TOLERANCE 8
+
+// greedy meshes of every chunk, drawn with basic.vert/basic.frag
+struct RasterChunk
+{
+    uint32_t VAO, VBO, EBO;
+    uint32_t indexCount;
+    glm::ivec3 origin;
+};
+
+static void buildRasterChunks(const std::vector<Voxel> &voxels, std::vector<RasterChunk> &chunks, RayMarchScene &scene)
+{
+    ChunkMap t_occupancy;
+    std::map<std::tuple<int, int, int>, std::vector<Voxel>> t_chunks;
+    for (const Voxel &voxel : voxels)
+    {
+        glm::ivec3 t_key = ChunkMap::ChunkCoord(glm::ivec3(voxel.pos));
+        t_chunks[std::make_tuple(t_key.x, t_key.y, t_key.z)].push_back(voxel);
+        t_occupancy.Set(glm::ivec3(voxel.pos), true);
+    }
+    std::vector<MeshVertex> t_vertices;
+    std::vector<uint32_t> t_indices;
+    for (auto &entry : t_chunks)
+    {
+        t_vertices.clear();
+        t_indices.clear();
+        buildMesh(entry.second, t_occupancy, MeshMode::Greedy, false, t_vertices, t_indices);
+        if (t_indices.empty())
+            continue;
+        RasterChunk t_chunk;
+        t_chunk.indexCount = (uint32_t)t_indices.size();
+        t_chunk.origin = ChunkMap::ChunkCoord(glm::ivec3(entry.second.front().pos)) * CHUNK_SIZE;
+        glGenVertexArrays(1, &t_chunk.VAO);
+        glBindVertexArray(t_chunk.VAO);
+        glGenBuffers(1, &t_chunk.VBO);
+        glGenBuffers(1, &t_chunk.EBO);
+        glBindBuffer(GL_ARRAY_BUFFER, t_chunk.VBO);
+        glBufferData(GL_ARRAY_BUFFER, t_vertices.size() * sizeof(MeshVertex), t_vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, t_chunk.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, t_indices.size() * sizeof(uint32_t), t_indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, sizeof(MeshVertex), (void *)offsetof(MeshVertex, packed));
+        glEnableVertexAttribArray(1);
+        glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, sizeof(MeshVertex), (void *)offsetof(MeshVertex, material));
+        glBindVertexArray(0);
+        chunks.push_back(t_chunk);
+        scene.triangles += t_chunk.indexCount / 3;
+        scene.meshBytes += t_vertices.size() * sizeof(MeshVertex) + t_indices.size() * sizeof(uint32_t);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// true when a pixel of the 3x3 block around x, y differs in coverage from
+// it, outside the frame counts as not covered
+static bool onSilhouette(const std::vector<uint8_t> &pixels, int x, int y)
+{
+    bool t_covered = pixels[((size_t)y * SCR_WIDTH + x) * 4 + 3] != 0;
+    for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            int t_x = x + dx, t_y = y + dy;
+            bool t_inside = t_x >= 0 && t_x < SCR_WIDTH && t_y >= 0 && t_y < SCR_HEIGHT;
+            if ((t_inside && pixels[((size_t)t_y * SCR_WIDTH + t_x) * 4 + 3] != 0) != t_covered)
+                return true;
+        }
+    return false;
+}
+
+static RayMarchScene benchmarkScene(const std::vector<Voxel> &voxels, uint32_t paletteTexture, Light light, int frames)
+{
+    RayMarchScene result = {(uint32_t)voxels.size(), 0, 0, 0, 0.f, 0.f, 0, 0, 0, 0};
+    if (voxels.empty())
+        return result;
+
+    glm::vec3 t_min = glm::vec3(voxels.front().pos), t_max = t_min;
+    for (const Voxel &voxel : voxels)
+    {
+        t_min = glm::min(t_min, glm::vec3(voxel.pos));
+        t_max = glm::max(t_max, glm::vec3(voxel.pos));
+    }
+    glm::vec3 t_centre = (t_min + t_max) * 0.5f;
+    float t_radius = glm::length(t_max - t_min) * 0.5f;
+    glm::vec3 t_eye = t_centre + glm::normalize(glm::vec3(0.6f, 0.5f, 1.f)) * t_radius * 2.2f;
+    MVP t_mvp;
+    t_mvp.model = glm::mat4(1.f);
+    t_mvp.view = glm::lookAt(t_eye, t_centre, glm::vec3(0.f, 1.f, 0.f));
+    t_mvp.projection = glm::perspective(glm::radians(45.f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, t_radius * 4.f);
+
+    uint32_t t_framebuffer, t_color, t_depth;
+    glGenFramebuffers(1, &t_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, t_framebuffer);
+    glGenRenderbuffers(1, &t_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, t_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t_color);
+    glGenRenderbuffers(1, &t_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, t_depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, SCR_WIDTH, SCR_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, t_depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "RAYMARCH::BENCHMARK::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return result;
+    }
+    GLint t_viewport[4];
+    glGetIntegerv(GL_VIEWPORT, t_viewport);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.f, 0.f, 0.f, 0.f);
+
+    // raster path
+    std::vector<RasterChunk> t_chunks;
+    buildRasterChunks(voxels, t_chunks, result);
+    Shader t_basic;
+    t_basic.Init("basic", "basic", getVertexLayoutDefines());
+    std::vector<uint8_t> t_rasterPixels((size_t)SCR_WIDTH * SCR_HEIGHT * 4), t_rayMarchPixels(t_rasterPixels.size());
+    glFinish();
+    auto t_start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        t_basic.Use();
+        t_basic.SetVec3("viewPos", t_eye);
+        t_basic.SetVec3("light.direction", light.direction);
+        t_basic.SetVec3("light.ambient", light.ambient);
+        t_basic.SetVec3("light.diffuse", light.diffuse);
+        t_basic.SetVec3("light.specular", light.specular);
+        t_basic.SetMat4("projection", t_mvp.projection);
+        t_basic.SetMat4("view", t_mvp.view);
+        t_basic.SetMat4("model", t_mvp.model);
+        t_basic.SetInt("materials", 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_BUFFER, paletteTexture);
+        for (const RasterChunk &chunk : t_chunks)
+        {
+            t_basic.SetIVec3("chunkOrigin", chunk.origin);
+            glBindVertexArray(chunk.VAO);
+            glDrawElements(GL_TRIANGLES, (GLsizei)chunk.indexCount, GL_UNSIGNED_INT, (void *)0);
+        }
+        glBindVertexArray(0);
+    }
+    glFinish();
+    result.rasterTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count() / frames;
+    glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, t_rasterPixels.data());
+    for (const RasterChunk &chunk : t_chunks)
+    {
+        glDeleteVertexArrays(1, &chunk.VAO);
+        glDeleteBuffers(1, &chunk.VBO);
+        glDeleteBuffers(1, &chunk.EBO);
+    }
+
+    // ray marched path
+    VolumeRenderer t_volume;
+    t_volume.Init();
+    t_volume.Upload(voxels);
+    result.volumeBytes = t_volume.GetStats().bytes;
+    glFinish();
+    t_start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; frame++)
+    {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        t_volume.Draw(t_mvp, t_eye, light, paletteTexture);
+    }
+    glFinish();
+    result.rayMarchTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count() / frames;
+    glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, t_rayMarchPixels.data());
+    t_volume.Destroy();
+
+    // both paths write alpha 1 where they hit a voxel, along silhouettes the
+    // triangle edges and the marched rays may round a pixel either way
+    for (size_t i = 0; i < t_rasterPixels.size(); i += 4)
+    {
+        bool t_raster = t_rasterPixels[i + 3] != 0;
+        bool t_rayMarch = t_rayMarchPixels[i + 3] != 0;
+        if (t_raster)
+            result.coveredPixels++;
+        if (t_raster != t_rayMarch)
+        {
+            result.coverageMismatches++;
+            int x = (int)(i / 4 % SCR_WIDTH), y = (int)(i / 4 / SCR_WIDTH);
+            if (!onSilhouette(t_rasterPixels, x, y) && !onSilhouette(t_rayMarchPixels, x, y))
+                result.interiorMismatches++;
+            continue;
+        }
+        for (int c = 0; c < 3; c++)
+            if (std::abs(t_rasterPixels[i + c] - t_rayMarchPixels[i + c]) > RAYMARCH_COLOR_TOLERANCE)
+            {
+                result.colorMismatches++;
+                break;
+            }
+    }
+
+    glViewport(t_viewport[0], t_viewport[1], t_viewport[2], t_viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteRenderbuffers(1, &t_color);
+    glDeleteRenderbuffers(1, &t_depth);
+    glDeleteFramebuffers(1, &t_framebuffer);
+    return result;
+}
+
+RayMarchBenchmark benchmarkRayMarching(int radius, int blockSize, int frames)
+{
+    RayMarchBenchmark result = {};
+    if (getMaterialPalette().empty())
+        registerMaterial(loadMaterial("ruby"));
+    std::vector<Material> t_materials = getMaterialPalette();
+    std::vector<glm::vec4> t_palette = packMaterialPalette(t_materials);
+    uint32_t t_paletteTBO, t_paletteTexture;
+    glGenBuffers(1, &t_paletteTBO);
+    glBindBuffer(GL_TEXTURE_BUFFER, t_paletteTBO);
+    glBufferData(GL_TEXTURE_BUFFER, t_palette.size() * sizeof(glm::vec4), t_palette.data(), GL_STATIC_DRAW);
+    glGenTextures(1, &t_paletteTexture);
+    glBindTexture(GL_TEXTURE_BUFFER, t_paletteTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, t_paletteTBO);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    Light t_light = {{-0.3f, -1.f, -0.5f}, {0.2f, 0.2f, 0.2f}, {0.5f, 0.5f, 0.5f}, {1.f, 1.f, 1.f}};
+    MaterialID t_materialCount = (MaterialID)t_materials.size();
+
+    std::vector<Voxel> t_voxels;
+    int r = radius;
+    for (int x = -r; x <= r; x++)
+        for (int y = -r; y <= r; y++)
+            for (int z = -r; z <= r; z++)
+                if (x * x + y * y + z * z <= r * r)
+                    t_voxels.push_back({glm::i16vec3(x, y, z), (MaterialID)(((x + r) / 16 + (y + r) / 16) % t_materialCount)});
+    result.ball = benchmarkScene(t_voxels, t_paletteTexture, t_light, frames);
+
+    t_voxels.clear();
+    uint32_t t_seed = 2463534242u;
+    for (int x = 0; x < 2 * blockSize; x++)
+        for (int y = 0; y < blockSize; y++)
+            for (int z = 0; z < blockSize / 2; z++)
+                if (xorshift(t_seed) & 1)
+                    t_voxels.push_back({glm::i16vec3(x, y, z), (MaterialID)(xorshift(t_seed) % t_materialCount)});
+    result.noise = benchmarkScene(t_voxels, t_paletteTexture, t_light, frames);
+
+    glDeleteTextures(1, &t_paletteTexture);
+    glDeleteBuffers(1, &t_paletteTBO);
+    return result;
+}
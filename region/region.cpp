@@ -0,0 +1,106 @@
+#include "region.hpp"
+
+bool RegionFile::Open(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_slots.clear();
+    m_fileSize = 0;
+    if (m_file.is_open())
+        m_file.close();
+    m_file.open(path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (m_file.bad() || m_file.fail())
+    {
+        std::cout << "REGION::OPEN::FILE_BAD " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void RegionFile::Clear()
+{
+    std::string t_path;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        t_path = m_path;
+    }
+    if (!t_path.empty())
+        Open(t_path);
+}
+
+bool RegionFile::Write(glm::ivec3 chunkCoord, const std::vector<Voxel> &voxels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open())
+        return false;
+
+    auto it = m_slots.find(chunkCoord);
+    if (it == m_slots.end() || it->second.capacity < voxels.size())
+    {
+        // the old slot is abandoned, the file only shrinks on Clear
+        Slot t_slot = {m_fileSize, 0, (uint32_t)voxels.size()};
+        m_fileSize += voxels.size() * sizeof(Voxel);
+        m_slots[chunkCoord] = t_slot;
+        it = m_slots.find(chunkCoord);
+    }
+    it->second.count = (uint32_t)voxels.size();
+
+    m_file.seekp((std::streamoff)it->second.offset);
+    m_file.write((const char *)voxels.data(), voxels.size() * sizeof(Voxel));
+    if (m_file.fail())
+    {
+        std::cout << "REGION::WRITE::FILE_BAD " << m_path << std::endl;
+        m_file.clear();
+        m_slots.erase(chunkCoord);
+        return false;
+    }
+    return true;
+}
+
+bool RegionFile::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.is_open())
+        return false;
+    m_file.flush();
+    if (m_file.fail())
+    {
+        std::cout << "REGION::FLUSH::FILE_BAD " << m_path << std::endl;
+        m_file.clear();
+        return false;
+    }
+    return true;
+}
+
+bool RegionFile::Read(glm::ivec3 chunkCoord, std::vector<Voxel> &voxels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    voxels.clear();
+    auto it = m_slots.find(chunkCoord);
+    if (it == m_slots.end())
+        return false;
+
+    voxels.resize(it->second.count);
+    m_file.seekg((std::streamoff)it->second.offset);
+    m_file.read((char *)voxels.data(), voxels.size() * sizeof(Voxel));
+    if (m_file.fail())
+    {
+        std::cout << "REGION::READ::FILE_BAD " << m_path << std::endl;
+        m_file.clear();
+        voxels.clear();
+        return false;
+    }
+    return true;
+}
+
+bool RegionFile::Contains(glm::ivec3 chunkCoord)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_slots.count(chunkCoord) != 0;
+}
+
+size_t RegionFile::GetFileSize()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (size_t)m_fileSize;
+}
@@ -0,0 +1,44 @@
+#include "../items/items.hpp"
+#include "../chunk/chunk.hpp"
+
+#include <glm/glm.hpp>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef REGION_HPP
+#define REGION_HPP
+
+// Scratch file holding the voxels of chunks that were paged out. The slot
+// directory only lives in memory, the file is truncated when opened.
+// Safe to use from several threads. Writes stay in the stream buffer until
+// Flush, reads always see them.
+class RegionFile
+{
+public:
+  bool Open(const std::string &path);
+  void Clear();
+  bool Write(glm::ivec3 chunkCoord, const std::vector<Voxel> &voxels);
+  bool Flush();
+  bool Read(glm::ivec3 chunkCoord, std::vector<Voxel> &voxels);
+  bool Contains(glm::ivec3 chunkCoord);
+  size_t GetFileSize();
+
+private:
+  struct Slot
+  {
+    uint64_t offset;
+    uint32_t count;
+    uint32_t capacity; // voxels that fit before the slot has to move
+  };
+
+  std::mutex m_mutex;
+  std::fstream m_file;
+  std::string m_path;
+  std::unordered_map<glm::ivec3, Slot, ChunkKeyHash> m_slots;
+  uint64_t m_fileSize;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "shader.hpp"
 
-void Shader::Init(const std::string &vertFileName, const std::string &fragFileName)
+void Shader::Init(const std::string &vertFileName, const std::string &fragFileName,
+                  const std::string &defines)
 {
     std::ifstream vertFile(std::string(FILES_PATH) + vertFileName + GLSL_VERTEX_FILE_EXTENSION);
     std::ifstream fragFile(std::string(FILES_PATH) + fragFileName + GLSL_FRAGMENT_FILE_EXTENSION);
@@ -16,8 +17,8 @@ void Shader::Init(const std::string &vertFileName, const std::string &fragFileNa
     vertFile.close();
     fragFile.close();
 
-    std::string vertexCode = vertSStream.str();
-    std::string fragmentCode = fragSStream.str();
+    std::string vertexCode = addDefines(vertSStream.str(), defines);
+    std::string fragmentCode = addDefines(fragSStream.str(), defines);
 
     const char *vShaderCode = vertexCode.c_str();
     const char *fShaderCode = fragmentCode.c_str();
@@ -42,6 +43,53 @@ void Shader::Init(const std::string &vertFileName, const std::string &fragFileNa
 
     glDeleteShader(vert);
     glDeleteShader(frag);
+
+    cacheUniforms();
+}
+
+// GLSL wants #version first, everything else may follow it
+std::string Shader::addDefines(const std::string &code, const std::string &defines) const
+{
+    if (defines.empty())
+        return code;
+    size_t t_line = code.find('\n');
+    if (code.compare(0, 8, "#version") != 0 || t_line == std::string::npos)
+        return defines + code;
+    return code.substr(0, t_line + 1) + defines + code.substr(t_line + 1);
+}
+
+// Resolves every active uniform once so setters never ask the driver
+void Shader::cacheUniforms()
+{
+    m_uniforms.clear();
+    GLint t_count = 0;
+    glGetProgramiv(shaderID, GL_ACTIVE_UNIFORMS, &t_count);
+    GLint t_maxLength = 0;
+    glGetProgramiv(shaderID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &t_maxLength);
+    std::string t_name(t_maxLength > 0 ? t_maxLength : 1, '\0');
+    for (GLint i = 0; i < t_count; i++)
+    {
+        GLsizei t_length = 0;
+        GLint t_size = 0;
+        GLenum t_type = 0;
+        glGetActiveUniform(shaderID, (GLuint)i, (GLsizei)t_name.size(), &t_length, &t_size, &t_type, &t_name[0]);
+        std::string t_uniformName = t_name.substr(0, t_length);
+        GLint t_location = glGetUniformLocation(shaderID, t_uniformName.c_str());
+        m_uniforms[t_uniformName] = t_location;
+        // arrays are reported as name[0], also allow plain name
+        size_t t_bracket = t_uniformName.find("[0]");
+        if (t_bracket != std::string::npos && t_bracket + 3 == t_uniformName.size())
+            m_uniforms[t_uniformName.substr(0, t_bracket)] = t_location;
+    }
+}
+
+Uniform Shader::GetUniform(const std::string &name) const
+{
+    Uniform t_uniform;
+    auto it = m_uniforms.find(name);
+    if (it != m_uniforms.end())
+        t_uniform.location = it->second;
+    return t_uniform;
 }
 
 void Shader::Use()
@@ -51,22 +99,62 @@ void Shader::Use()
 
 void Shader::SetMat4(const std::string &name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    SetMat4(GetUniform(name), mat);
 }
 
 void Shader::SetVec3(const std::string &name, const glm::vec3 &vec) const
 {
-    glUniform3fv(glGetUniformLocation(shaderID, name.c_str()), 1, &vec[0]);
+    SetVec3(GetUniform(name), vec);
+}
+
+void Shader::SetIVec3(const std::string &name, const glm::ivec3 &vec) const
+{
+    SetIVec3(GetUniform(name), vec);
 }
 
 void Shader::SetVec4(const std::string &name, const glm::vec4 &vec) const
 {
-    glUniform4fv(glGetUniformLocation(shaderID, name.c_str()), 1, &vec[0]);
+    SetVec4(GetUniform(name), vec);
 }
 
 void Shader::SetFloat(const std::string &name, const float &value) const
 {
-    glUniform1f(glGetUniformLocation(shaderID, name.c_str()), value);
+    SetFloat(GetUniform(name), value);
+}
+
+void Shader::SetInt(const std::string &name, int value) const
+{
+    SetInt(GetUniform(name), value);
+}
+
+void Shader::SetMat4(Uniform uniform, const glm::mat4 &mat) const
+{
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::SetVec3(Uniform uniform, const glm::vec3 &vec) const
+{
+    glUniform3fv(uniform.location, 1, &vec[0]);
+}
+
+void Shader::SetIVec3(Uniform uniform, const glm::ivec3 &vec) const
+{
+    glUniform3iv(uniform.location, 1, &vec[0]);
+}
+
+void Shader::SetVec4(Uniform uniform, const glm::vec4 &vec) const
+{
+    glUniform4fv(uniform.location, 1, &vec[0]);
+}
+
+void Shader::SetFloat(Uniform uniform, const float &value) const
+{
+    glUniform1f(uniform.location, value);
+}
+
+void Shader::SetInt(Uniform uniform, int value) const
+{
+    glUniform1i(uniform.location, value);
 }
 
 void Shader::checkCompileErrors(uint32_t shader, std::string type)
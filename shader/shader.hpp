@@ -6,24 +6,46 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <string>
+#include <unordered_map>
 
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
+// Location of a uniform resolved once, -1 when the program does not use it
+struct Uniform
+{
+  GLint location = -1;
+};
+
 class Shader
 {
 public:
-  void Init(const std::string &vertFileName, const std::string &fragFileName);
+  // defines are inserted after the #version line of both stages
+  void Init(const std::string &vertFileName, const std::string &fragFileName,
+            const std::string &defines = "");
 
   void Use();
+  Uniform GetUniform(const std::string &name) const;
   void SetMat4(const std::string &name, const glm::mat4 &mat) const;
   void SetVec3(const std::string &name, const glm::vec3 &vec) const;
+  void SetIVec3(const std::string &name, const glm::ivec3 &vec) const;
   void SetVec4(const std::string &name, const glm::vec4 &vec) const;
   void SetFloat(const std::string &name, const float &value) const;
+  void SetInt(const std::string &name, int value) const;
+  void SetMat4(Uniform uniform, const glm::mat4 &mat) const;
+  void SetVec3(Uniform uniform, const glm::vec3 &vec) const;
+  void SetIVec3(Uniform uniform, const glm::ivec3 &vec) const;
+  void SetVec4(Uniform uniform, const glm::vec4 &vec) const;
+  void SetFloat(Uniform uniform, const float &value) const;
+  void SetInt(Uniform uniform, int value) const;
 
 private:
   uint32_t shaderID;
+  std::unordered_map<std::string, GLint> m_uniforms;
 
+  void cacheUniforms();
+  std::string addDefines(const std::string &code, const std::string &defines) const;
   void checkCompileErrors(uint32_t shader, std::string type);
 };
 
@@ -0,0 +1,213 @@
+#include "dag.hpp"
+#include "octree_ray.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+// FNV-1a over the words of a node
+static uint64_t hashWords(const uint32_t *words, size_t count)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < count; i++)
+    {
+        hash ^= words[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+SparseVoxelDag::SparseVoxelDag()
+{
+    Clear();
+}
+
+void SparseVoxelDag::Clear()
+{
+    m_words.clear();
+    m_materials.clear();
+    m_root = 0;
+    m_nodeCount = 0;
+    m_origin = glm::ivec3(0);
+    m_depth = 0;
+}
+
+void SparseVoxelDag::Build(const SparseVoxelOctree &octree, JobSystem *jobSystem)
+{
+    Clear();
+    const std::vector<SvoNode> &nodes = octree.GetNodes();
+    if (nodes.empty())
+        return;
+    m_depth = octree.GetDepth();
+    m_origin = octree.GetOrigin();
+    m_materials = octree.GetMaterials();
+
+    // the octree is breadth first, so every level is one range of nodes
+    std::vector<size_t> t_levelStart(m_depth + 1);
+    t_levelStart[0] = 0;
+    for (int level = 0; level < m_depth - 1; level++)
+        t_levelStart[level + 1] = nodes[t_levelStart[level]].firstChild;
+    t_levelStart[m_depth] = nodes.size();
+
+    // DAG offset and voxel count of every node of the level below
+    std::vector<uint32_t> t_childIds, t_childCounts;
+    std::vector<uint32_t> t_ids, t_counts;
+    std::vector<uint32_t> t_keyWords, t_keyStart;
+    std::vector<uint64_t> t_hashes;
+    std::vector<std::vector<uint32_t>> t_shards(DAG_SHARDS), t_unique(DAG_SHARDS);
+    std::vector<uint32_t> t_local;
+    for (int level = m_depth - 1; level >= 0; level--)
+    {
+        size_t t_begin = t_levelStart[level];
+        size_t t_count = t_levelStart[level + 1] - t_begin;
+        bool t_last = level == m_depth - 1;
+
+        // the words each node would be written as, they are also its key
+        t_keyWords.clear();
+        t_keyStart.assign(1, 0);
+        t_counts.resize(t_count);
+        t_hashes.resize(t_count);
+        for (std::vector<uint32_t> &shard : t_shards)
+            shard.clear();
+        for (size_t i = 0; i < t_count; i++)
+        {
+            const SvoNode &node = nodes[t_begin + i];
+            int t_children = popCount(node.childMask);
+            uint32_t t_voxels = 0;
+            size_t t_at = t_keyWords.size();
+            t_keyWords.push_back(node.childMask);
+            t_keyWords.push_back(0);
+            if (t_last)
+                t_voxels = t_children;
+            else
+            {
+                size_t t_first = node.firstChild - t_levelStart[level + 1];
+                for (int k = 0; k < t_children; k++)
+                {
+                    t_keyWords.push_back(t_childIds[t_first + k]);
+                    t_voxels += t_childCounts[t_first + k];
+                }
+            }
+            t_keyWords[t_at + 1] = t_voxels;
+            t_keyStart.push_back((uint32_t)t_keyWords.size());
+            t_counts[i] = t_voxels;
+            t_hashes[i] = hashWords(&t_keyWords[t_at], t_keyWords.size() - t_at);
+            t_shards[t_hashes[i] % DAG_SHARDS].push_back((uint32_t)i);
+        }
+
+        // equal nodes always land in the same shard, so shards deduplicate
+        // independently; t_local is the node's index in its shard's list
+        t_local.resize(t_count);
+        for (int shard = 0; shard < DAG_SHARDS; shard++)
+        {
+            auto t_job = [&, shard]()
+            {
+                std::unordered_map<uint64_t, std::vector<uint32_t>> t_seen;
+                std::vector<uint32_t> &unique = t_unique[shard];
+                unique.clear();
+                for (uint32_t i : t_shards[shard])
+                {
+                    std::vector<uint32_t> &candidates = t_seen[t_hashes[i]];
+                    uint32_t t_length = t_keyStart[i + 1] - t_keyStart[i];
+                    bool t_found = false;
+                    for (uint32_t candidate : candidates)
+                    {
+                        uint32_t j = unique[candidate];
+                        if (t_keyStart[j + 1] - t_keyStart[j] == t_length &&
+                            std::equal(&t_keyWords[t_keyStart[i]], &t_keyWords[t_keyStart[i]] + t_length, &t_keyWords[t_keyStart[j]]))
+                        {
+                            t_local[i] = candidate;
+                            t_found = true;
+                            break;
+                        }
+                    }
+                    if (t_found)
+                        continue;
+                    t_local[i] = (uint32_t)unique.size();
+                    candidates.push_back((uint32_t)unique.size());
+                    unique.push_back(i);
+                }
+            };
+            if (jobSystem)
+                jobSystem->Submit(t_job);
+            else
+                t_job();
+        }
+        if (jobSystem)
+            jobSystem->Wait();
+
+        // write the unique nodes shard by shard
+        std::vector<uint32_t> t_shardIds[DAG_SHARDS];
+        for (int shard = 0; shard < DAG_SHARDS; shard++)
+            for (uint32_t i : t_unique[shard])
+            {
+                t_shardIds[shard].push_back((uint32_t)m_words.size());
+                m_words.insert(m_words.end(), t_keyWords.begin() + t_keyStart[i], t_keyWords.begin() + t_keyStart[i + 1]);
+                m_nodeCount++;
+            }
+        t_ids.resize(t_count);
+        for (size_t i = 0; i < t_count; i++)
+            t_ids[i] = t_shardIds[t_hashes[i] % DAG_SHARDS][t_local[i]];
+        t_childIds.swap(t_ids);
+        t_childCounts.swap(t_counts);
+    }
+    m_root = t_childIds[0];
+}
+
+bool SparseVoxelDag::Get(glm::ivec3 pos, MaterialID &mat) const
+{
+    if (m_words.empty())
+        return false;
+    glm::ivec3 t_local = pos - m_origin;
+    int t_size = 1 << m_depth;
+    if (glm::any(glm::lessThan(t_local, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(t_local, glm::ivec3(t_size))))
+        return false;
+
+    uint32_t t_node = m_root;
+    uint32_t t_index = 0;
+    for (int level = 0; level < m_depth; level++)
+    {
+        int t_shift = m_depth - 1 - level;
+        int t_octant = ((t_local.x >> t_shift) & 1) | ((t_local.y >> t_shift) & 1) << 1 | ((t_local.z >> t_shift) & 1) << 2;
+        uint32_t t_mask = m_words[t_node];
+        if (!(t_mask & (1u << t_octant)))
+            return false;
+        int t_rank = popCount(t_mask & ((1u << t_octant) - 1));
+        if (level == m_depth - 1)
+        {
+            t_index += t_rank;
+            break;
+        }
+        // skip the voxels of the subtrees in front of this one
+        const uint32_t *children = &m_words[t_node + 2];
+        for (int k = 0; k < t_rank; k++)
+            t_index += m_words[children[k] + 1];
+        t_node = children[t_rank];
+    }
+    mat = m_materials[t_index];
+    return true;
+}
+
+// the octree traversal, children are found through the child words
+RayHit SparseVoxelDag::CastRay(glm::vec3 origin, glm::vec3 dir, float maxDistance) const
+{
+    if (m_words.empty())
+        return {false, glm::ivec3(0), glm::ivec3(0), maxDistance};
+    auto t_childMask = [this](uint32_t node) { return m_words[node]; };
+    auto t_child = [this](uint32_t node, int rank) { return m_words[node + 2 + rank]; };
+    return castOctreeRay(m_root, m_origin, m_depth, t_childMask, t_child, origin, dir, maxDistance);
+}
+
+size_t SparseVoxelDag::GetMemoryUsage() const
+{
+    return GetGeometryBytes() + m_materials.size() * sizeof(MaterialID);
+}
+
+size_t SparseVoxelDag::GetGeometryBytes() const
+{
+    return m_words.size() * sizeof(uint32_t);
+}
+
+size_t SparseVoxelDag::GetNodeCount() const
+{
+    return m_nodeCount;
+}
@@ -0,0 +1,71 @@
+#include "svo.hpp"
+#include "../job_system/job_system.hpp"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef DAG_HPP
+#define DAG_HPP
+
+// nodes of one level are split into this many hash shards, each shard is
+// deduplicated by its own job
+#define DAG_SHARDS 64
+
+struct DagBenchmarkModel
+{
+  uint32_t voxelCount;
+  size_t svoNodes;
+  size_t dagNodes;
+  size_t svoBytes; // geometry only, materials are the same for both
+  size_t dagBytes;
+  float serialBuildTime;   // ms
+  float parallelBuildTime; // ms
+  uint32_t mismatches;     // point and ray queries that disagree with the octree
+};
+
+struct DagBenchmark
+{
+  unsigned threads;
+  DagBenchmarkModel doggo;       // doggo.vxl as is
+  DagBenchmarkModel doggoScaled; // doggo.vxl scaled by SVO_BENCHMARK_SCALE
+  DagBenchmarkModel test;        // test.vxl
+};
+
+// Sparse voxel DAG, the octree with identical subtrees stored once. A node
+// is a child mask, the voxel count of its subtree and one word per child;
+// nodes of the last level have no child words. Geometry is shared, so the
+// materials stay in Morton order and a voxel's material index is the sum
+// of the voxel counts of the subtrees in front of it.
+class SparseVoxelDag
+{
+public:
+  SparseVoxelDag();
+
+  // deduplicates the octree bottom up, level by level, on jobSystem when
+  // it is given
+  void Build(const SparseVoxelOctree &octree, JobSystem *jobSystem);
+  void Clear();
+
+  bool Get(glm::ivec3 pos, MaterialID &mat) const;
+  RayHit CastRay(glm::vec3 origin, glm::vec3 dir, float maxDistance) const;
+
+  size_t GetMemoryUsage() const; // geometry and materials
+  size_t GetGeometryBytes() const;
+  size_t GetNodeCount() const;
+
+private:
+  std::vector<uint32_t> m_words;
+  std::vector<MaterialID> m_materials;
+  uint32_t m_root; // word offset of the root node
+  size_t m_nodeCount;
+  glm::ivec3 m_origin;
+  int m_depth;
+};
+
+// Compression and build time on the test models, parallel builds use
+// threads job system threads
+DagBenchmark benchmarkDag(unsigned threads);
+
+#endif
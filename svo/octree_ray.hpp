@@ -0,0 +1,132 @@
+#include "../raycast/raycast.hpp"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifndef OCTREE_RAY_HPP
+#define OCTREE_RAY_HPP
+
+// a node per level of a 16 bit position plus the root
+#define OCTREE_MAX_DEPTH 17
+#define OCTREE_STACK_SIZE (OCTREE_MAX_DEPTH * 8)
+
+// Helpers shared by SparseVoxelOctree and SparseVoxelDag, both walk the
+// same octree and only store their nodes differently
+
+inline int popCount(uint32_t bits)
+{
+#ifdef _MSC_VER
+  return (int)__popcnt(bits);
+#else
+  return __builtin_popcount(bits);
+#endif
+}
+
+inline glm::ivec3 octantOffset(int octant)
+{
+  return glm::ivec3(octant & 1, (octant >> 1) & 1, (octant >> 2) & 1);
+}
+
+// slab test against the cells [lo, lo + size), returns the entry axis
+inline bool intersectCells(glm::ivec3 lo, int size, glm::vec3 origin, glm::vec3 invDir,
+                           float &tEnter, float &tExit, int &axis)
+{
+  glm::vec3 t1 = (glm::vec3(lo) - glm::vec3(0.5f) - origin) * invDir;
+  glm::vec3 t2 = (glm::vec3(lo) + glm::vec3(size - 0.5f) - origin) * invDir;
+  glm::vec3 tNear = glm::min(t1, t2);
+  glm::vec3 tFar = glm::max(t1, t2);
+  tEnter = glm::max(glm::max(tNear.x, tNear.y), tNear.z);
+  tExit = glm::min(glm::min(tFar.x, tFar.y), tFar.z);
+  axis = tEnter == tNear.x ? 0 : (tEnter == tNear.y ? 1 : 2);
+  return tEnter <= tExit && tExit >= 0.f;
+}
+
+// Depth first ray cast through an octree of 2^depth cells per axis starting
+// at the cell origin. childMask(node) gives the octant bits of a node and
+// child(node, rank) the rank-th existing child of a node above the last
+// level. Children are pushed far to near so the nearest one is visited
+// first and every box starting behind the best hit is skipped. Same
+// conventions as castRay, voxel centres sit on integer coordinates.
+template <typename ChildMask, typename Child>
+RayHit castOctreeRay(uint32_t root, glm::ivec3 treeOrigin, int depth, ChildMask childMask, Child child,
+                     glm::vec3 origin, glm::vec3 dir, float maxDistance)
+{
+  RayHit hit = {false, glm::ivec3(0), glm::ivec3(0), maxDistance};
+  float length = glm::length(dir);
+  if (length == 0.f || depth == 0)
+    return hit;
+  dir /= length;
+  glm::vec3 invDir = 1.f / dir;
+
+  struct Entry
+  {
+    uint32_t node;
+    int level;
+    glm::ivec3 base; // first cell of the node
+    float tEnter;
+  };
+  Entry stack[OCTREE_STACK_SIZE];
+  int t_top = 0;
+
+  float tEnter, tExit;
+  int axis;
+  if (!intersectCells(treeOrigin, 1 << depth, origin, invDir, tEnter, tExit, axis) || tEnter > maxDistance)
+    return hit;
+  stack[t_top++] = {root, 0, treeOrigin, tEnter};
+
+  Entry children[8];
+  while (t_top > 0)
+  {
+    Entry entry = stack[--t_top];
+    if (entry.tEnter > hit.distance)
+      continue;
+    uint32_t t_mask = childMask(entry.node);
+    int t_half = 1 << (depth - 1 - entry.level);
+    bool t_leaves = entry.level == depth - 1;
+    int t_childCount = 0;
+    int t_rank = 0;
+    for (int octant = 0; octant < 8; octant++)
+    {
+      if (!(t_mask & (1u << octant)))
+        continue;
+      int t_slot = t_rank++;
+      glm::ivec3 t_base = entry.base + octantOffset(octant) * t_half;
+      if (!intersectCells(t_base, t_half, origin, invDir, tEnter, tExit, axis) || tEnter > hit.distance)
+        continue;
+      if (!t_leaves)
+      {
+        children[t_childCount++] = {child(entry.node, t_slot), entry.level + 1, t_base, tEnter};
+        continue;
+      }
+      glm::ivec3 normal = glm::ivec3(0);
+      if (tEnter < 0.f)
+        tEnter = 0.f;
+      else
+        normal[axis] = dir[axis] > 0.f ? -1 : 1;
+      if (hit.hit && tEnter == hit.distance)
+        continue;
+      hit = {true, t_base, normal, tEnter};
+    }
+    // at most 8 children, an insertion sort far to near is enough and
+    // keeps std::sort's unrolled code off the fixed array
+    for (int i = 1; i < t_childCount; i++)
+    {
+      Entry t_entry = children[i];
+      int j = i;
+      for (; j > 0 && children[j - 1].tEnter < t_entry.tEnter; j--)
+        children[j] = children[j - 1];
+      children[j] = t_entry;
+    }
+    for (int i = 0; i < t_childCount; i++)
+      stack[t_top++] = children[i];
+  }
+  if (!hit.hit)
+    hit.distance = 0.f;
+  return hit;
+}
+
+#endif
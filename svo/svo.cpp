@@ -0,0 +1,213 @@
+#include "svo.hpp"
+#include "octree_ray.hpp"
+
+#include <algorithm>
+
+// spreads the low 21 bits of v so two zero bits follow each of them
+static uint64_t spreadBits(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+SparseVoxelOctree::SparseVoxelOctree()
+{
+    Clear();
+}
+
+void SparseVoxelOctree::Clear()
+{
+    m_nodes.clear();
+    m_materials.clear();
+    m_origin = glm::ivec3(0);
+    m_depth = 0;
+}
+
+// Sorts the voxels by Morton code, then builds the levels bottom up: the
+// parents of a sorted level are runs of equal code >> 3 and come out
+// sorted again, so each level is already in breadth first order
+void SparseVoxelOctree::Build(const std::vector<Voxel> &voxels)
+{
+    Clear();
+    if (voxels.empty())
+        return;
+
+    glm::ivec3 min = glm::ivec3(voxels.front().pos);
+    glm::ivec3 max = min;
+    for (const Voxel &voxel : voxels)
+    {
+        min = glm::min(min, glm::ivec3(voxel.pos));
+        max = glm::max(max, glm::ivec3(voxel.pos));
+    }
+    glm::ivec3 t_extent = max - min + glm::ivec3(1);
+    int t_largest = std::max(std::max(t_extent.x, t_extent.y), t_extent.z);
+    m_depth = 1;
+    while ((1 << m_depth) < t_largest)
+        m_depth++;
+    m_origin = min;
+
+    // (Morton code, voxel index)
+    std::vector<std::pair<uint64_t, uint32_t>> t_codes;
+    t_codes.reserve(voxels.size());
+    for (size_t i = 0; i < voxels.size(); i++)
+    {
+        glm::ivec3 t_local = glm::ivec3(voxels[i].pos) - m_origin;
+        t_codes.push_back(std::make_pair(spreadBits(t_local.x) | spreadBits(t_local.y) << 1 | spreadBits(t_local.z) << 2, (uint32_t)i));
+    }
+    std::sort(t_codes.begin(), t_codes.end());
+
+    // the last voxel at a position wins, like AddVoxel replacing the colour
+    std::vector<uint64_t> t_keys;
+    t_keys.reserve(t_codes.size());
+    m_materials.reserve(t_codes.size());
+    for (size_t i = 0; i < t_codes.size(); i++)
+    {
+        if (i + 1 < t_codes.size() && t_codes[i + 1].first == t_codes[i].first)
+            continue;
+        t_keys.push_back(t_codes[i].first);
+        m_materials.push_back(voxels[t_codes[i].second].mat);
+    }
+
+    // levels[l] holds the nodes at depth l, their firstChild is relative to
+    // levels[l + 1] until the levels are joined
+    std::vector<std::vector<SvoNode>> t_levels(m_depth);
+    std::vector<uint64_t> t_parents;
+    for (int level = m_depth - 1; level >= 0; level--)
+    {
+        std::vector<SvoNode> &nodes = t_levels[level];
+        t_parents.clear();
+        for (size_t i = 0; i < t_keys.size(); i++)
+        {
+            uint64_t t_parent = t_keys[i] >> 3;
+            if (t_parents.empty() || t_parents.back() != t_parent)
+            {
+                t_parents.push_back(t_parent);
+                nodes.push_back({(uint32_t)i, 0});
+            }
+            nodes.back().childMask |= (uint8_t)(1u << (t_keys[i] & 7));
+        }
+        t_keys.swap(t_parents);
+    }
+
+    size_t t_count = 0;
+    for (const std::vector<SvoNode> &nodes : t_levels)
+        t_count += nodes.size();
+    m_nodes.reserve(t_count);
+    for (int level = 0; level < m_depth; level++)
+    {
+        uint32_t t_childOffset = (uint32_t)(m_nodes.size() + t_levels[level].size());
+        for (SvoNode node : t_levels[level])
+        {
+            if (level < m_depth - 1)
+                node.firstChild += t_childOffset;
+            m_nodes.push_back(node);
+        }
+    }
+}
+
+bool SparseVoxelOctree::Get(glm::ivec3 pos, MaterialID &mat) const
+{
+    if (m_nodes.empty())
+        return false;
+    glm::ivec3 t_local = pos - m_origin;
+    int t_size = 1 << m_depth;
+    if (glm::any(glm::lessThan(t_local, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(t_local, glm::ivec3(t_size))))
+        return false;
+
+    uint32_t t_node = 0;
+    for (int level = 0; level < m_depth; level++)
+    {
+        int t_shift = m_depth - 1 - level;
+        int t_octant = ((t_local.x >> t_shift) & 1) | ((t_local.y >> t_shift) & 1) << 1 | ((t_local.z >> t_shift) & 1) << 2;
+        const SvoNode &node = m_nodes[t_node];
+        if (!(node.childMask & (1u << t_octant)))
+            return false;
+        t_node = node.firstChild + popCount(node.childMask & ((1u << t_octant) - 1));
+    }
+    mat = m_materials[t_node];
+    return true;
+}
+
+RayHit SparseVoxelOctree::CastRay(glm::vec3 origin, glm::vec3 dir, float maxDistance) const
+{
+    if (m_nodes.empty())
+        return {false, glm::ivec3(0), glm::ivec3(0), maxDistance};
+    auto t_childMask = [this](uint32_t node) { return (uint32_t)m_nodes[node].childMask; };
+    auto t_child = [this](uint32_t node, int rank) { return m_nodes[node].firstChild + rank; };
+    return castOctreeRay(0, m_origin, m_depth, t_childMask, t_child, origin, dir, maxDistance);
+}
+
+void SparseVoxelOctree::GetRegion(glm::ivec3 min, glm::ivec3 max, std::vector<Voxel> &voxels) const
+{
+    if (m_nodes.empty())
+        return;
+    struct Entry
+    {
+        uint32_t node;
+        int level;
+        glm::ivec3 base;
+    };
+    Entry stack[OCTREE_STACK_SIZE];
+    int t_top = 0;
+    stack[t_top++] = {0, 0, m_origin};
+    while (t_top > 0)
+    {
+        Entry entry = stack[--t_top];
+        const SvoNode &node = m_nodes[entry.node];
+        int t_half = 1 << (m_depth - 1 - entry.level);
+        int t_rank = 0;
+        for (int octant = 0; octant < 8; octant++)
+        {
+            if (!(node.childMask & (1u << octant)))
+                continue;
+            uint32_t t_child = node.firstChild + t_rank++;
+            glm::ivec3 t_base = entry.base + octantOffset(octant) * t_half;
+            if (glm::any(glm::greaterThan(t_base, max)) || glm::any(glm::lessThan(t_base + glm::ivec3(t_half - 1), min)))
+                continue;
+            if (entry.level == m_depth - 1)
+                voxels.push_back({glm::i16vec3(t_base), m_materials[t_child]});
+            else
+                stack[t_top++] = {t_child, entry.level + 1, t_base};
+        }
+    }
+}
+
+size_t SparseVoxelOctree::GetMemoryUsage() const
+{
+    return m_nodes.size() * sizeof(SvoNode) + m_materials.size() * sizeof(MaterialID);
+}
+
+size_t SparseVoxelOctree::GetNodeCount() const
+{
+    return m_nodes.size();
+}
+
+size_t SparseVoxelOctree::GetVoxelCount() const
+{
+    return m_materials.size();
+}
+
+int SparseVoxelOctree::GetDepth() const
+{
+    return m_depth;
+}
+
+glm::ivec3 SparseVoxelOctree::GetOrigin() const
+{
+    return m_origin;
+}
+
+const std::vector<SvoNode> &SparseVoxelOctree::GetNodes() const
+{
+    return m_nodes;
+}
+
+const std::vector<MaterialID> &SparseVoxelOctree::GetMaterials() const
+{
+    return m_materials;
+}
@@ -0,0 +1,78 @@
+#include "../items/items.hpp"
+#include "../raycast/raycast.hpp"
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifndef SVO_HPP
+#define SVO_HPP
+
+// doggo.vxl is scaled up by this per axis in the benchmark
+#define SVO_BENCHMARK_SCALE 16
+
+// Node of the octree, children of one node are stored next to each other
+// so a child is found from firstChild and the set bits below it
+struct SvoNode
+{
+  uint32_t firstChild; // node index, or material index on the last level
+  uint8_t childMask;   // bit x | y << 1 | z << 2 set when the octant holds voxels
+};
+
+struct SvoBenchmarkScene
+{
+  uint32_t voxelCount;
+  size_t svoBytes;
+  size_t denseBytes;
+  float buildTime;      // ms
+  float svoPointTime;   // ns per query
+  float densePointTime; // ns per query
+  float svoRayTime;     // us per ray
+  float ddaRayTime;     // us per ray, castRay on a ChunkMap
+  uint32_t mismatches;  // point or ray queries that disagree
+};
+
+struct SvoBenchmark
+{
+  SvoBenchmarkScene doggo;  // doggo.vxl scaled by SVO_BENCHMARK_SCALE
+  SvoBenchmarkScene sparse; // random balls in a VOXEL_COUNT^3 grid
+};
+
+// Pointer-free sparse voxel octree, nodes are stored breadth first with the
+// root at index 0 and materials in Morton order after the last node level.
+// The tree is static, edits rebuild it.
+class SparseVoxelOctree
+{
+public:
+  SparseVoxelOctree();
+
+  void Build(const std::vector<Voxel> &voxels);
+  void Clear();
+
+  bool Get(glm::ivec3 pos, MaterialID &mat) const;
+  // same conventions as castRay, voxel centres sit on integer coordinates
+  RayHit CastRay(glm::vec3 origin, glm::vec3 dir, float maxDistance) const;
+  // appends every voxel inside [min, max]
+  void GetRegion(glm::ivec3 min, glm::ivec3 max, std::vector<Voxel> &voxels) const;
+
+  size_t GetMemoryUsage() const;
+  size_t GetNodeCount() const;
+  size_t GetVoxelCount() const;
+  int GetDepth() const;
+  glm::ivec3 GetOrigin() const;
+  const std::vector<SvoNode> &GetNodes() const;
+  const std::vector<MaterialID> &GetMaterials() const;
+
+private:
+  std::vector<SvoNode> m_nodes;
+  std::vector<MaterialID> m_materials;
+  glm::ivec3 m_origin; // first cell covered by the root
+  int m_depth;         // the root covers 2^m_depth cells per axis
+};
+
+// Compares the octree with a dense VOXEL_COUNT^3 grid on the scaled up
+// doggo and on a sparse generated scene
+SvoBenchmark benchmarkSvo();
+
+#endif
@@ -0,0 +1,206 @@
+#include "svo.hpp"
+#include "dag.hpp"
+#include "../raycast/ray_benchmark.hpp"
+#include "../voxel_file/voxel_file.hpp"
+
+#include <chrono>
+
+#define SVO_BENCHMARK_POINTS 1000000
+#define SVO_BENCHMARK_RAYS 10000
+#define SVO_BENCHMARK_BALLS 64
+
+// Reads a text or binary model from files/ with its lowest voxel at the
+// origin, every voxel becomes a scale^3 block, cells past VOXEL_COUNT are dropped
+static std::vector<Voxel> loadModel(const std::string &name, int scale)
+{
+    std::string t_path = std::string(FILES_PATH) + name + VOXEL_FILE_EXTENSION;
+    VoxelModel t_model;
+    std::vector<Voxel> result;
+    bool t_loaded = isBinaryVoxelFile(t_path) ? loadVoxelFile(t_path, t_model) : importVoxelText(t_path, t_model);
+    if (!t_loaded || t_model.voxels.empty())
+        return result;
+    glm::ivec3 t_min = glm::ivec3(t_model.voxels.front().pos);
+    for (const Voxel &voxel : t_model.voxels)
+        t_min = glm::min(t_min, glm::ivec3(voxel.pos));
+    for (const Voxel &voxel : t_model.voxels)
+    {
+        glm::ivec3 t_base = (glm::ivec3(voxel.pos) - t_min) * scale;
+        for (int x = 0; x < scale; x++)
+            for (int y = 0; y < scale; y++)
+                for (int z = 0; z < scale; z++)
+                {
+                    glm::ivec3 t_pos = t_base + glm::ivec3(x, y, z);
+                    if (glm::all(glm::lessThan(t_pos, glm::ivec3(VOXEL_COUNT))))
+                        result.push_back({glm::i16vec3(t_pos), voxel.mat});
+                }
+    }
+    return result;
+}
+
+// voxels must lie inside [0, VOXEL_COUNT)^3
+static SvoBenchmarkScene benchmarkScene(const std::vector<Voxel> &voxels)
+{
+    SvoBenchmarkScene result = {(uint32_t)voxels.size(), 0, 0, 0.f, 0.f, 0.f, 0.f, 0.f, 0};
+    if (voxels.empty())
+        return result;
+
+    // the dense grid stores material + 1, 0 is empty
+    std::vector<MaterialID> t_dense((size_t)VOXEL_COUNT * VOXEL_COUNT * VOXEL_COUNT, 0);
+    ChunkMap t_occupancy;
+    for (const Voxel &voxel : voxels)
+    {
+        t_dense[((size_t)voxel.pos.x * VOXEL_COUNT + voxel.pos.y) * VOXEL_COUNT + voxel.pos.z] = voxel.mat + 1;
+        t_occupancy.Set(glm::ivec3(voxel.pos), true);
+    }
+    result.denseBytes = t_dense.size() * sizeof(MaterialID);
+
+    SparseVoxelOctree t_svo;
+    auto t_start = std::chrono::steady_clock::now();
+    t_svo.Build(voxels);
+    result.buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    result.svoBytes = t_svo.GetMemoryUsage();
+
+    // half of the points are voxels, the rest anywhere in the grid
+    uint32_t t_seed = 2463534242u;
+    std::vector<glm::ivec3> t_points(SVO_BENCHMARK_POINTS);
+    for (size_t i = 0; i < t_points.size(); i++)
+    {
+        if (i % 2)
+            t_points[i] = glm::ivec3(voxels[xorshift(t_seed) % voxels.size()].pos);
+        else
+            t_points[i] = glm::ivec3(xorshift(t_seed) % VOXEL_COUNT, xorshift(t_seed) % VOXEL_COUNT, xorshift(t_seed) % VOXEL_COUNT);
+    }
+
+    std::vector<MaterialID> t_svoResults(t_points.size()), t_denseResults(t_points.size());
+    t_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < t_points.size(); i++)
+    {
+        MaterialID t_mat;
+        t_svoResults[i] = t_svo.Get(t_points[i], t_mat) ? t_mat + 1 : 0;
+    }
+    result.svoPointTime = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - t_start).count() / t_points.size();
+
+    t_start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < t_points.size(); i++)
+    {
+        const glm::ivec3 &p = t_points[i];
+        t_denseResults[i] = t_dense[((size_t)p.x * VOXEL_COUNT + p.y) * VOXEL_COUNT + p.z];
+    }
+    result.densePointTime = std::chrono::duration<float, std::nano>(std::chrono::steady_clock::now() - t_start).count() / t_points.size();
+    for (size_t i = 0; i < t_points.size(); i++)
+        if (t_svoResults[i] != t_denseResults[i])
+            result.mismatches++;
+
+    // rays from a sphere around the grid towards points near random voxels
+    glm::vec3 t_centre = glm::vec3(VOXEL_COUNT / 2.f);
+    std::vector<glm::vec3> t_origins, t_dirs;
+    for (uint32_t i = 0; i < SVO_BENCHMARK_RAYS; i++)
+    {
+        glm::vec3 t_origin = randomRayOrigin(t_seed, t_centre, (float)VOXEL_COUNT);
+        glm::vec3 t_target = glm::vec3(voxels[xorshift(t_seed) % voxels.size()].pos) +
+                             glm::vec3(randomFloat(t_seed), randomFloat(t_seed), randomFloat(t_seed)) * 8.f;
+        t_origins.push_back(t_origin);
+        t_dirs.push_back(t_target - t_origin);
+    }
+
+    float t_range = VOXEL_COUNT * 3.f;
+    std::vector<RayHit> t_svoHits(SVO_BENCHMARK_RAYS), t_ddaHits(SVO_BENCHMARK_RAYS);
+    t_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < SVO_BENCHMARK_RAYS; i++)
+        t_svoHits[i] = t_svo.CastRay(t_origins[i], t_dirs[i], t_range);
+    result.svoRayTime = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t_start).count() / SVO_BENCHMARK_RAYS;
+
+    t_start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < SVO_BENCHMARK_RAYS; i++)
+        t_ddaHits[i] = castRay(t_occupancy, t_origins[i], t_dirs[i], t_range);
+    result.ddaRayTime = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - t_start).count() / SVO_BENCHMARK_RAYS;
+    for (uint32_t i = 0; i < SVO_BENCHMARK_RAYS; i++)
+        if (t_svoHits[i].hit != t_ddaHits[i].hit ||
+            (t_svoHits[i].hit && (t_svoHits[i].cell != t_ddaHits[i].cell || t_svoHits[i].normal != t_ddaHits[i].normal)))
+            result.mismatches++;
+
+    return result;
+}
+
+SvoBenchmark benchmarkSvo()
+{
+    SvoBenchmark result;
+
+    result.doggo = benchmarkScene(loadModel("doggo", SVO_BENCHMARK_SCALE));
+
+    // balls of radius 2 to 9 scattered through the whole grid
+    std::vector<Voxel> t_sparse;
+    uint32_t t_seed = 88172645u;
+    for (int i = 0; i < SVO_BENCHMARK_BALLS; i++)
+    {
+        int r = 2 + xorshift(t_seed) % 8;
+        uint32_t t_span = VOXEL_COUNT - 2 * r;
+        glm::ivec3 t_centre = glm::ivec3(r) + glm::ivec3(xorshift(t_seed) % t_span, xorshift(t_seed) % t_span, xorshift(t_seed) % t_span);
+        MaterialID t_mat = (MaterialID)(i % 4);
+        for (int x = -r; x <= r; x++)
+            for (int y = -r; y <= r; y++)
+                for (int z = -r; z <= r; z++)
+                    if (x * x + y * y + z * z <= r * r)
+                        t_sparse.push_back({glm::i16vec3(t_centre + glm::ivec3(x, y, z)), t_mat});
+    }
+    result.sparse = benchmarkScene(t_sparse);
+
+    return result;
+}
+
+static DagBenchmarkModel benchmarkDagModel(const std::vector<Voxel> &voxels, JobSystem &jobSystem)
+{
+    DagBenchmarkModel result = {(uint32_t)voxels.size(), 0, 0, 0, 0, 0.f, 0.f, 0};
+    if (voxels.empty())
+        return result;
+    SparseVoxelOctree t_svo;
+    t_svo.Build(voxels);
+    result.svoNodes = t_svo.GetNodeCount();
+    result.svoBytes = t_svo.GetNodeCount() * sizeof(SvoNode);
+
+    SparseVoxelDag t_dag;
+    auto t_start = std::chrono::steady_clock::now();
+    t_dag.Build(t_svo, nullptr);
+    result.serialBuildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    t_start = std::chrono::steady_clock::now();
+    t_dag.Build(t_svo, &jobSystem);
+    result.parallelBuildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    result.dagNodes = t_dag.GetNodeCount();
+    result.dagBytes = t_dag.GetGeometryBytes();
+
+    // every voxel, its neighbours and rays towards random voxels
+    for (const Voxel &voxel : voxels)
+        for (int face = 0; face < 7; face++)
+        {
+            glm::ivec3 t_pos = glm::ivec3(voxel.pos);
+            if (face < 6)
+                t_pos[face / 2] += (face % 2 == 0) ? 1 : -1;
+            MaterialID t_svoMat = 0, t_dagMat = 0;
+            bool t_svoHit = t_svo.Get(t_pos, t_svoMat);
+            if (t_svoHit != t_dag.Get(t_pos, t_dagMat) || t_svoMat != t_dagMat)
+                result.mismatches++;
+        }
+    uint32_t t_seed = 2463534242u;
+    glm::vec3 t_centre = glm::vec3(VOXEL_COUNT / 2.f);
+    for (uint32_t i = 0; i < SVO_BENCHMARK_RAYS; i++)
+    {
+        glm::vec3 t_origin = randomRayOrigin(t_seed, t_centre, (float)VOXEL_COUNT);
+        glm::vec3 t_dir = glm::vec3(voxels[xorshift(t_seed) % voxels.size()].pos) - t_origin;
+        RayHit t_svoHit = t_svo.CastRay(t_origin, t_dir, VOXEL_COUNT * 3.f);
+        RayHit t_dagHit = t_dag.CastRay(t_origin, t_dir, VOXEL_COUNT * 3.f);
+        if (t_svoHit.hit != t_dagHit.hit || t_svoHit.cell != t_dagHit.cell || t_svoHit.normal != t_dagHit.normal)
+            result.mismatches++;
+    }
+    return result;
+}
+
+DagBenchmark benchmarkDag(unsigned threads)
+{
+    DagBenchmark result;
+    JobSystem t_jobSystem(threads);
+    result.threads = t_jobSystem.GetThreadCount();
+    result.doggo = benchmarkDagModel(loadModel("doggo", 1), t_jobSystem);
+    result.doggoScaled = benchmarkDagModel(loadModel("doggo", SVO_BENCHMARK_SCALE), t_jobSystem);
+    result.test = benchmarkDagModel(loadModel("test", 1), t_jobSystem);
+    return result;
+}
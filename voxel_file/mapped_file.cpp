@@ -0,0 +1,100 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+    m_data = nullptr;
+    m_size = 0;
+#ifdef _WIN32
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const std::string &path)
+{
+    Close();
+#ifdef _WIN32
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER t_size;
+    if (!GetFileSizeEx(m_file, &t_size) || t_size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+    m_size = (size_t)t_size.QuadPart;
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+    {
+        Close();
+        return false;
+    }
+    m_data = (const char *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int t_fd = open(path.c_str(), O_RDONLY);
+    if (t_fd < 0)
+        return false;
+    struct stat t_stat;
+    if (fstat(t_fd, &t_stat) != 0 || t_stat.st_size == 0)
+    {
+        close(t_fd);
+        return false;
+    }
+    m_size = (size_t)t_stat.st_size;
+    void *t_data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, t_fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(t_fd);
+    m_data = t_data == MAP_FAILED ? nullptr : (const char *)t_data;
+#endif
+    if (!m_data)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = nullptr;
+#else
+    if (m_data)
+        munmap((void *)m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const char *MappedFile::GetData() const
+{
+    return m_data;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return m_size;
+}
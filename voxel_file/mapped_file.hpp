@@ -0,0 +1,30 @@
+#include <cstddef>
+#include <string>
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+// Read only view of a whole file, pages are faulted in as they are touched
+class MappedFile
+{
+public:
+  MappedFile();
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool Open(const std::string &path);
+  void Close();
+  const char *GetData() const;
+  size_t GetSize() const;
+
+private:
+  const char *m_data;
+  size_t m_size;
+#ifdef _WIN32
+  void *m_file;
+  void *m_mapping;
+#endif
+};
+
+#endif
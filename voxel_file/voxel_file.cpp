@@ -0,0 +1,457 @@
+#include "voxel_file.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static_assert(sizeof(Voxel) == 8, "plain records are read straight into Voxel");
+
+struct VoxelFileHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t flags;
+    uint32_t materialCount;
+    uint32_t voxelCount;
+    uint32_t recordCount;
+};
+
+struct VoxelRun
+{
+    int16_t x, y, z;
+    uint16_t mat;
+    uint16_t length;
+};
+
+template <typename T>
+static void put(std::vector<char> &buffer, const T &value)
+{
+    size_t t_at = buffer.size();
+    buffer.resize(t_at + sizeof(T));
+    memcpy(&buffer[t_at], &value, sizeof(T));
+}
+
+template <typename T>
+static bool get(const char *data, size_t size, size_t &at, T &value)
+{
+    if (size - at < sizeof(T))
+        return false;
+    memcpy(&value, data + at, sizeof(T));
+    at += sizeof(T);
+    return true;
+}
+
+static size_t align8(size_t offset)
+{
+    return (offset + 7) & ~(size_t)7;
+}
+
+static inline int popCount(uint32_t bits)
+{
+#ifdef _MSC_VER
+    return (int)__popcnt(bits);
+#else
+    return __builtin_popcount(bits);
+#endif
+}
+
+// the voxels of a chunk have to fit int16 positions
+static bool isChunkCoordValid(glm::ivec3 coord)
+{
+    const int t_min = INT16_MIN / CHUNK_SIZE;
+    const int t_max = INT16_MAX / CHUNK_SIZE;
+    return glm::all(glm::greaterThanEqual(coord, glm::ivec3(t_min))) && glm::all(glm::lessThanEqual(coord, glm::ivec3(t_max)));
+}
+
+static uint32_t countOccupancy(const Chunk &chunk)
+{
+    uint32_t t_count = 0;
+    for (int x = 0; x < CHUNK_SIZE; x++)
+        for (int y = 0; y < CHUNK_SIZE; y++)
+            t_count += popCount(chunk.columns[x][y]);
+    return t_count;
+}
+
+bool saveVoxelFile(const std::string &path, const VoxelModel &model)
+{
+    std::unordered_map<glm::ivec3, std::vector<Voxel>, ChunkKeyHash> t_chunkVoxels;
+    for (const Voxel &voxel : model.voxels)
+        t_chunkVoxels[ChunkMap::ChunkCoord(glm::ivec3(voxel.pos))].push_back(voxel);
+    std::vector<glm::ivec3> t_coords;
+    for (auto &entry : t_chunkVoxels)
+        t_coords.push_back(entry.first);
+    std::sort(t_coords.begin(), t_coords.end(), [](const glm::ivec3 &a, const glm::ivec3 &b)
+              { return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z); });
+
+    VoxelFileHeader t_header;
+    memcpy(t_header.magic, VOXEL_FILE_MAGIC, 4);
+    t_header.version = VOXEL_FILE_VERSION;
+    t_header.flags = 0;
+    t_header.materialCount = (uint32_t)model.materials.size();
+    t_header.voxelCount = (uint32_t)model.voxels.size();
+    t_header.recordCount = (uint32_t)t_coords.size();
+
+    std::vector<char> t_buffer;
+    put(t_buffer, t_header);
+    for (const std::string &material : model.materials)
+    {
+        put(t_buffer, (uint16_t)material.size());
+        t_buffer.insert(t_buffer.end(), material.begin(), material.end());
+    }
+    t_buffer.resize(align8(t_buffer.size()), 0);
+
+    size_t t_offset = align8(t_buffer.size() + t_coords.size() * sizeof(VoxelFileChunk));
+    for (const glm::ivec3 &coord : t_coords)
+    {
+        uint32_t t_count = (uint32_t)t_chunkVoxels[coord].size();
+        VoxelFileChunk t_entry = {coord.x, coord.y, coord.z, t_count, t_offset};
+        put(t_buffer, t_entry);
+        t_offset = align8(t_offset + sizeof(Chunk) + t_count * sizeof(Voxel));
+    }
+
+    for (const glm::ivec3 &coord : t_coords)
+    {
+        const std::vector<Voxel> &voxels = t_chunkVoxels[coord];
+        Chunk t_chunk;
+        memset(&t_chunk, 0, sizeof(Chunk));
+        for (const Voxel &voxel : voxels)
+        {
+            glm::ivec3 t_local = ChunkMap::LocalCoord(glm::ivec3(voxel.pos));
+            t_chunk.columns[t_local.x][t_local.y] |= 1u << t_local.z;
+        }
+        t_chunk.voxelCount = (uint32_t)voxels.size();
+
+        t_buffer.resize(align8(t_buffer.size()), 0);
+        put(t_buffer, t_chunk);
+        size_t t_at = t_buffer.size();
+        t_buffer.resize(t_at + voxels.size() * sizeof(Voxel));
+        memcpy(&t_buffer[t_at], voxels.data(), voxels.size() * sizeof(Voxel));
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (file.bad() || file.fail())
+    {
+        std::cout << "VOXEL_FILE::SAVE::FILE_BAD " << path << std::endl;
+        return false;
+    }
+    file.write(t_buffer.data(), t_buffer.size());
+    return true;
+}
+
+static bool readHeader(const char *data, size_t size, size_t &at, VoxelFileHeader &header,
+                       std::vector<std::string> &materials)
+{
+    at = 0;
+    materials.clear();
+    if (!get(data, size, at, header) || memcmp(header.magic, VOXEL_FILE_MAGIC, 4) != 0)
+    {
+        std::cout << "VOXEL_FILE::LOAD::NOT_A_VOXEL_FILE" << std::endl;
+        return false;
+    }
+    if (header.version < 1 || header.version > VOXEL_FILE_VERSION)
+    {
+        std::cout << "VOXEL_FILE::LOAD::UNKNOWN_VERSION " << header.version << std::endl;
+        return false;
+    }
+    for (uint32_t i = 0; i < header.materialCount; i++)
+    {
+        uint16_t t_length;
+        if (!get(data, size, at, t_length) || size - at < t_length)
+        {
+            std::cout << "VOXEL_FILE::LOAD::TRUNCATED" << std::endl;
+            return false;
+        }
+        materials.emplace_back(data + at, t_length);
+        at += t_length;
+    }
+    return true;
+}
+
+// version 1 records, voxels or runs along z
+static bool readRecords(const char *data, size_t size, size_t at, const VoxelFileHeader &header,
+                        VoxelModel &model)
+{
+    size_t t_recordSize = (header.flags & VOXEL_FILE_RLE) ? sizeof(VoxelRun) : sizeof(Voxel);
+    if ((size - at) / t_recordSize < header.recordCount)
+    {
+        std::cout << "VOXEL_FILE::LOAD::TRUNCATED" << std::endl;
+        return false;
+    }
+
+    if (header.flags & VOXEL_FILE_RLE)
+    {
+        // sized from the runs, the header's voxel count is not checked against the file
+        std::vector<VoxelRun> t_runs(header.recordCount);
+        if (header.recordCount)
+            memcpy(t_runs.data(), data + at, header.recordCount * sizeof(VoxelRun));
+        size_t t_voxelCount = 0;
+        for (const VoxelRun &run : t_runs)
+            t_voxelCount += run.length;
+        model.voxels.reserve(t_voxelCount);
+        for (const VoxelRun &run : t_runs)
+            for (int z = 0; z < run.length; z++)
+                model.voxels.push_back({glm::i16vec3(run.x, run.y, run.z + z), run.mat});
+    }
+    else
+    {
+        model.voxels.resize(header.recordCount);
+        if (header.recordCount)
+            memcpy(model.voxels.data(), data + at, header.recordCount * sizeof(Voxel));
+    }
+    return true;
+}
+
+bool loadVoxelFile(const std::string &path, VoxelModel &model)
+{
+    model.materials.clear();
+    model.voxels.clear();
+
+    MappedFile t_file;
+    if (!t_file.Open(path))
+    {
+        std::cout << "VOXEL_FILE::LOAD::FILE_BAD " << path << std::endl;
+        return false;
+    }
+    size_t t_at;
+    VoxelFileHeader t_header;
+    if (!readHeader(t_file.GetData(), t_file.GetSize(), t_at, t_header, model.materials))
+        return false;
+
+    if (t_header.version == 1)
+    {
+        if (!readRecords(t_file.GetData(), t_file.GetSize(), t_at, t_header, model))
+            return false;
+    }
+    else
+    {
+        t_file.Close();
+        VoxelFileView t_view;
+        if (!t_view.Open(path))
+            return false;
+        // the chunk counts were checked against the file size by Open
+        size_t t_voxelCount = 0;
+        for (const MappedChunk &chunk : t_view.GetChunks())
+            t_voxelCount += chunk.voxelCount;
+        model.voxels.reserve(t_voxelCount);
+        for (const MappedChunk &chunk : t_view.GetChunks())
+        {
+            if (!checkMappedChunk(chunk))
+            {
+                std::cout << "VOXEL_FILE::LOAD::BAD_CHUNK " << path << std::endl;
+                model.voxels.clear();
+                return false;
+            }
+            model.voxels.insert(model.voxels.end(), chunk.voxels, chunk.voxels + chunk.voxelCount);
+        }
+    }
+
+    for (const Voxel &voxel : model.voxels)
+        if (voxel.mat >= model.materials.size())
+        {
+            std::cout << "VOXEL_FILE::LOAD::BAD_MATERIAL " << voxel.mat << std::endl;
+            model.voxels.clear();
+            return false;
+        }
+    return true;
+}
+
+bool VoxelFileView::Open(const std::string &path)
+{
+    m_chunks.clear();
+    if (!m_file.Open(path))
+    {
+        std::cout << "VOXEL_FILE::OPEN::FILE_BAD " << path << std::endl;
+        return false;
+    }
+
+    const char *t_data = m_file.GetData();
+    size_t t_size = m_file.GetSize();
+    size_t t_at;
+    VoxelFileHeader t_header;
+    if (!readHeader(t_data, t_size, t_at, t_header, m_materials) || t_header.version != 2)
+    {
+        m_file.Close();
+        return false;
+    }
+
+    t_at = align8(t_at);
+    if (t_at > t_size || (t_size - t_at) / sizeof(VoxelFileChunk) < t_header.recordCount)
+    {
+        std::cout << "VOXEL_FILE::OPEN::TRUNCATED " << path << std::endl;
+        m_file.Close();
+        return false;
+    }
+    m_chunks.reserve(t_header.recordCount);
+    std::unordered_set<glm::ivec3, ChunkKeyHash> t_coords;
+    for (uint32_t i = 0; i < t_header.recordCount; i++)
+    {
+        VoxelFileChunk t_entry;
+        get(t_data, t_size, t_at, t_entry);
+        if (t_entry.offset % 8 != 0 || t_entry.offset > t_size ||
+            t_size - t_entry.offset < sizeof(Chunk) ||
+            (t_size - t_entry.offset - sizeof(Chunk)) / sizeof(Voxel) < t_entry.voxelCount)
+        {
+            std::cout << "VOXEL_FILE::OPEN::TRUNCATED " << path << std::endl;
+            m_chunks.clear();
+            m_file.Close();
+            return false;
+        }
+        // the voxel payload is used in place and only checked when the chunk
+        // is unpacked, the occupancy is read here since loading copies it
+        MappedChunk t_chunk;
+        t_chunk.coord = glm::ivec3(t_entry.x, t_entry.y, t_entry.z);
+        t_chunk.occupancy = (const Chunk *)(t_data + t_entry.offset);
+        t_chunk.voxels = (const Voxel *)(t_data + t_entry.offset + sizeof(Chunk));
+        t_chunk.voxelCount = t_entry.voxelCount;
+        if (!isChunkCoordValid(t_chunk.coord) || !t_coords.insert(t_chunk.coord).second ||
+            t_chunk.occupancy->voxelCount != t_entry.voxelCount || countOccupancy(*t_chunk.occupancy) != t_entry.voxelCount)
+        {
+            std::cout << "VOXEL_FILE::OPEN::BAD_CHUNK " << path << std::endl;
+            m_chunks.clear();
+            m_file.Close();
+            return false;
+        }
+        m_chunks.push_back(t_chunk);
+    }
+    return true;
+}
+
+const std::vector<std::string> &VoxelFileView::GetMaterials() const
+{
+    return m_materials;
+}
+
+const std::vector<MappedChunk> &VoxelFileView::GetChunks() const
+{
+    return m_chunks;
+}
+
+bool checkMappedChunk(const MappedChunk &chunk)
+{
+    // bits are cleared as voxels claim them, so a repeated position fails too
+    Chunk t_left = *chunk.occupancy;
+    glm::ivec3 t_base = chunk.coord * CHUNK_SIZE;
+    for (uint32_t i = 0; i < chunk.voxelCount; i++)
+    {
+        glm::ivec3 t_local = glm::ivec3(chunk.voxels[i].pos) - t_base;
+        if (glm::any(glm::lessThan(t_local, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(t_local, glm::ivec3(CHUNK_SIZE))))
+            return false;
+        uint32_t &column = t_left.columns[t_local.x][t_local.y];
+        if (!(column & (1u << t_local.z)))
+            return false;
+        column &= ~(1u << t_local.z);
+    }
+    return true;
+}
+
+bool exportVoxelText(const std::string &path, const VoxelModel &model)
+{
+    std::ofstream file(path);
+    if (file.bad() || file.fail())
+    {
+        std::cout << "VOXEL_FILE::EXPORT::FILE_BAD " << path << std::endl;
+        return false;
+    }
+    for (const Voxel &voxel : model.voxels)
+        file << voxel.pos.x << " " << voxel.pos.y << " " << voxel.pos.z << " " << model.materials[voxel.mat] << "\n";
+    return true;
+}
+
+bool importVoxelText(const std::string &path, VoxelModel &model)
+{
+    model.materials.clear();
+    model.voxels.clear();
+
+    std::ifstream file(path);
+    if (file.bad() || file.fail())
+    {
+        std::cout << "VOXEL_FILE::IMPORT::FILE_BAD " << path << std::endl;
+        return false;
+    }
+    std::unordered_map<std::string, uint16_t> t_materialIndex;
+    glm::ivec3 t_pos;
+    std::string t_matName;
+    while (file >> t_pos.x >> t_pos.y >> t_pos.z >> t_matName)
+    {
+        if (glm::any(glm::lessThan(t_pos, glm::ivec3(std::numeric_limits<int16_t>::min()))) ||
+            glm::any(glm::greaterThan(t_pos, glm::ivec3(std::numeric_limits<int16_t>::max()))))
+        {
+            std::cout << "VOXEL_FILE::IMPORT::POS Out of bounds " << t_pos.x << " " << t_pos.y << " " << t_pos.z
+                      << std::endl;
+            model.materials.clear();
+            model.voxels.clear();
+            return false;
+        }
+        auto it = t_materialIndex.find(t_matName);
+        if (it == t_materialIndex.end())
+        {
+            it = t_materialIndex.emplace(t_matName, (uint16_t)model.materials.size()).first;
+            model.materials.push_back(t_matName);
+        }
+        model.voxels.push_back({glm::i16vec3(t_pos), it->second});
+    }
+    return true;
+}
+
+bool isBinaryVoxelFile(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    char t_magic[4];
+    if (!file.read(t_magic, 4))
+        return false;
+    return memcmp(t_magic, VOXEL_FILE_MAGIC, 4) == 0;
+}
+
+VoxelFileBenchmark benchmarkVoxelFile()
+{
+    VoxelFileBenchmark result = {0, 0, 0, 0.f, 0.f, 0.f};
+
+    // 100^3 cube with a few horizontal material layers
+    VoxelModel t_model;
+    t_model.materials = {"ruby", "jade", "pearl", "obsidian"};
+    for (int x = 0; x < 100; x++)
+        for (int y = 0; y < 100; y++)
+            for (int z = 0; z < 100; z++)
+                t_model.voxels.push_back({glm::i16vec3(x, y, z), (MaterialID)(y / 25)});
+    result.voxelCount = (uint32_t)t_model.voxels.size();
+
+    std::string t_textPath = std::string(FILES_PATH) + "benchmark_text" + VOXEL_FILE_EXTENSION;
+    std::string t_binaryPath = std::string(FILES_PATH) + "benchmark_binary" + VOXEL_FILE_EXTENSION;
+    if (!exportVoxelText(t_textPath, t_model) || !saveVoxelFile(t_binaryPath, t_model))
+        return result;
+
+    VoxelModel t_loaded;
+    auto t_start = std::chrono::steady_clock::now();
+    importVoxelText(t_textPath, t_loaded);
+    result.textLoadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+
+    t_start = std::chrono::steady_clock::now();
+    loadVoxelFile(t_binaryPath, t_loaded);
+    result.binaryLoadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+
+    t_start = std::chrono::steady_clock::now();
+    {
+        VoxelFileView t_view;
+        t_view.Open(t_binaryPath);
+    }
+    result.mappedLoadTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+
+    std::ifstream t_text(t_textPath, std::ios::binary | std::ios::ate);
+    result.textBytes = (size_t)t_text.tellg();
+    std::ifstream t_binary(t_binaryPath, std::ios::binary | std::ios::ate);
+    result.binaryBytes = (size_t)t_binary.tellg();
+    t_text.close();
+    t_binary.close();
+    std::remove(t_textPath.c_str());
+    std::remove(t_binaryPath.c_str());
+    return result;
+}
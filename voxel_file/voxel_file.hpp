@@ -0,0 +1,97 @@
+#include "../items/items.hpp"
+#include "../chunk/chunk.hpp"
+#include "mapped_file.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef VOXEL_FILE_HPP
+#define VOXEL_FILE_HPP
+
+// Binary .vxl layout, all values little endian:
+//   char     magic[4]       "VXLB"
+//   uint16_t version
+//   uint16_t flags          VOXEL_FILE_RLE, version 1 only
+//   uint32_t materialCount
+//   uint32_t voxelCount
+//   uint32_t recordCount
+//   materialCount x { uint16_t length; char name[length]; }
+// version 1, records are voxels or with VOXEL_FILE_RLE runs along z:
+//   recordCount x { int16_t x, y, z; uint16_t material; }
+//   recordCount x { int16_t x, y, z; uint16_t material; uint16_t length; }
+// version 2, records are chunks, everything from the directory on is 8 byte
+// aligned so a mapped file can be used in place:
+//   recordCount x VoxelFileChunk
+//   recordCount x { Chunk occupancy; Voxel voxels[voxelCount]; }
+#define VOXEL_FILE_MAGIC "VXLB"
+#define VOXEL_FILE_VERSION 2
+#define VOXEL_FILE_RLE 1
+
+struct VoxelFileChunk
+{
+  int32_t x, y, z;
+  uint32_t voxelCount;
+  uint64_t offset; // of the payload from the start of the file
+};
+
+// Voxels as stored in a file, mat indexes materials instead of the palette
+struct VoxelModel
+{
+  std::vector<std::string> materials;
+  std::vector<Voxel> voxels;
+};
+
+struct VoxelFileBenchmark
+{
+  uint32_t voxelCount;
+  size_t textBytes;
+  size_t binaryBytes;
+  float textLoadTime;   // ms
+  float binaryLoadTime; // ms
+  float mappedLoadTime; // ms, mapping and reading the chunk directory
+};
+
+// A chunk of a mapped file, the pointers stay valid while the view is open
+struct MappedChunk
+{
+  glm::ivec3 coord;
+  const Chunk *occupancy;
+  const Voxel *voxels; // mat indexes the materials of the file
+  uint32_t voxelCount;
+};
+
+// Version 2 file opened in place, chunk payloads are not read until used
+class VoxelFileView
+{
+public:
+  bool Open(const std::string &path);
+  const std::vector<std::string> &GetMaterials() const;
+  const std::vector<MappedChunk> &GetChunks() const;
+
+private:
+  MappedFile m_file;
+  std::vector<std::string> m_materials;
+  std::vector<MappedChunk> m_chunks;
+};
+
+// Every voxel of the chunk lies inside it, has its occupancy bit set and
+// appears once. Open only checks the directory and occupancy, this reads
+// the whole payload so it runs when a chunk is unpacked
+bool checkMappedChunk(const MappedChunk &chunk);
+
+// always writes the newest version
+bool saveVoxelFile(const std::string &path, const VoxelModel &model);
+bool loadVoxelFile(const std::string &path, VoxelModel &model);
+
+// one "x y z material" line per voxel
+bool exportVoxelText(const std::string &path, const VoxelModel &model);
+bool importVoxelText(const std::string &path, VoxelModel &model);
+
+bool isBinaryVoxelFile(const std::string &path);
+
+// Saves a 1M voxel model in both formats and times loading each, the mapped
+// time only opens the binary file in place
+VoxelFileBenchmark benchmarkVoxelFile();
+
+#endif